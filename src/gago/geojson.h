@@ -26,5 +26,12 @@
 #include <gago/geojson/geojson.h>
 #include <gago/geojson/rapid_json.h>
 #include <gago/geojson/geojson_impl.h>
+#include <gago/geojson/tile_index.h>
+#include <gago/geojson/writer.h>
+#include <gago/geojson/patch.h>
+#include <gago/geojson/summary.h>
+#include <gago/geojson/parser_context.h>
+#include <gago/geojson/builder.h>
+#include <gago/geojson/ingest.h>
 
 #endif //  GEOJSON_CPP_GAGO_GEOJSON_H_
@@ -0,0 +1,253 @@
+//
+// Copyright (c) 2018 ChuiZi (wuqinchun at gagogroup.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef GEOJSON_CPP_GAGO_GEOJSON_BUILDER_H_
+#define GEOJSON_CPP_GAGO_GEOJSON_BUILDER_H_
+
+#include <string>
+#include <cstddef>
+
+#include <rapidjson/document.h>
+
+#include <gago/macros.h>
+#include <gago/geojson/geojson.h>
+#include <gago/geojson/rapid_json.h>
+
+NS_GAGO_BEGIN
+NS_GEOJSON_BEGIN
+
+// build() walks GeoJSON and reports what it finds to a Builder, so that
+// any geometry and property types can be constructed straight from the
+// JSON. The builder is a template parameter: calls are resolved at compile
+// time and inline. A Builder provides
+//
+//   void begin_collection(std::size_t features);
+//   void end_collection();
+//   void begin_feature();
+//   void id(const rapidjson_value &id);
+//   void bbox(const rapidjson_value &bbox);
+//   void property(const char *key, std::size_t length, const rapidjson_value &value);
+//   void null_geometry();
+//   void end_feature();
+//   void begin_geometry(geometry_type type, std::size_t parts);
+//   void end_geometry();
+//   void begin_polygon(std::size_t rings);
+//   void end_polygon();
+//   void begin_path(std::size_t positions);
+//   void end_path();
+//   void position(double x, double y);
+//
+// `rapidjson_value` stands for the type of the JSON walked, any rapidjson
+// GenericValue. A feature reports its id and bbox, when it has them, then its
+// properties, then its geometry. `parts` is the number of positions, lines
+// or polygons of a multi geometry and 1 otherwise. A Point reports one
+// position; a MultiPoint its positions; a LineString one path; a
+// MultiLineString `parts` paths; a Polygon one polygon of `rings` paths,
+// the outer ring first; a MultiPolygon `parts` polygons. Coordinates are
+// reported as written.
+//
+// The converters of geojson_impl.h are this walk with geometry_builder,
+// the builder for this library's own types, which applies convert_options.
+
+namespace detail {
+
+template<typename Value, typename Builder>
+void build_position(const Value &json, Builder &builder) {
+  if (!json.IsArray() || json.Size() < 2)
+    throw error("coordinates array must have at least 2 numbers");
+  builder.position(json[0].GetDouble(), json[1].GetDouble());
+}
+
+template<typename Value, typename Builder>
+void build_positions(const Value &json, Builder &builder) {
+  for (const auto &position : json.GetArray())
+    build_position(position, builder);
+}
+
+template<typename Value, typename Builder>
+void build_path(const Value &json, Builder &builder) {
+  if (!json.IsArray())
+    throw error("coordinates property must be an array");
+  builder.begin_path(json.Size());
+  build_positions(json, builder);
+  builder.end_path();
+}
+
+template<typename Value, typename Builder>
+void build_polygon(const Value &json, Builder &builder) {
+  if (!json.IsArray())
+    throw error("coordinates property must be an array");
+  builder.begin_polygon(json.Size());
+  for (const auto &ring : json.GetArray())
+    build_path(ring, builder);
+  builder.end_polygon();
+}
+
+}  // namespace detail
+
+// Walks the coordinates array of a geometry of the given type.
+template<typename Value, typename Builder>
+void build_coordinates(const Value &json, geometry_type type, Builder &builder) {
+  if (!json.IsArray())
+    throw error("coordinates property must be an array");
+
+  switch (type) {
+    case geometry_type::POINT:
+      builder.begin_geometry(type, 1);
+      detail::build_position(json, builder);
+      break;
+    case geometry_type::MULTIPOINT:
+      builder.begin_geometry(type, json.Size());
+      detail::build_positions(json, builder);
+      break;
+    case geometry_type::LINESTRING:
+      builder.begin_geometry(type, 1);
+      detail::build_path(json, builder);
+      break;
+    case geometry_type::MULTILINESTRING:
+      builder.begin_geometry(type, json.Size());
+      for (const auto &line : json.GetArray())
+        detail::build_path(line, builder);
+      break;
+    case geometry_type::POLYGON:
+      builder.begin_geometry(type, 1);
+      detail::build_polygon(json, builder);
+      break;
+    case geometry_type::MULTIPOLYGON:
+      builder.begin_geometry(type, json.Size());
+      for (const auto &polygon : json.GetArray())
+        detail::build_polygon(polygon, builder);
+      break;
+  }
+  builder.end_geometry();
+}
+
+template<typename Value, typename Builder>
+void build_geometry(const Value &json, Builder &builder) {
+  if (!json.IsObject())
+    throw error("Geometry must be an object");
+
+  const auto &type_itr = json.FindMember("type");
+  if (type_itr == json.MemberEnd())
+    throw error("Geometry must have a type property");
+  const auto &type = type_itr->value;
+
+  const auto &coords_itr = json.FindMember("coordinates");
+  if (coords_itr == json.MemberEnd())
+    throw error(std::string(type.GetString()) + " geometry must have a coordinates property");
+  const auto &coords = coords_itr->value;
+
+  if (type == "Point")
+    build_coordinates(coords, geometry_type::POINT, builder);
+  else if (type == "MultiPoint")
+    build_coordinates(coords, geometry_type::MULTIPOINT, builder);
+  else if (type == "LineString")
+    build_coordinates(coords, geometry_type::LINESTRING, builder);
+  else if (type == "MultiLineString")
+    build_coordinates(coords, geometry_type::MULTILINESTRING, builder);
+  else if (type == "Polygon")
+    build_coordinates(coords, geometry_type::POLYGON, builder);
+  else if (type == "MultiPolygon")
+    build_coordinates(coords, geometry_type::MULTIPOLYGON, builder);
+  else
+    throw error(std::string(type.GetString()) + " not yet implemented");
+}
+
+template<typename Value, typename Builder>
+void build_feature(const Value &json, Builder &builder) {
+  if (!json.IsObject())
+    throw error("Feature must be an object");
+
+  const auto &json_end = json.MemberEnd();
+  const auto &type_itr = json.FindMember("type");
+  if (type_itr == json_end)
+    throw error("Feature must have a type property");
+  if (type_itr->value != "Feature")
+    throw error("Feature type must be Feature");
+
+  const auto &geom_itr = json.FindMember("geometry");
+  if (geom_itr == json_end)
+    throw error("Feature must have a geometry property");
+
+  builder.begin_feature();
+
+  const auto &id_itr = json.FindMember("id");
+  if (id_itr != json_end)
+    builder.id(id_itr->value);
+
+  const auto &bbox_itr = json.FindMember("bbox");
+  if (bbox_itr != json_end)
+    builder.bbox(bbox_itr->value);
+
+  const auto &prop_itr = json.FindMember("properties");
+  if (prop_itr != json_end && !prop_itr->value.IsNull()) {
+    if (!prop_itr->value.IsObject())
+      throw error("properties must be an object");
+    for (const auto &member : prop_itr->value.GetObject())
+      builder.property(member.name.GetString(), member.name.GetStringLength(), member.value);
+  }
+
+  if (geom_itr->value.IsNull())
+    builder.null_geometry();
+  else
+    build_geometry(geom_itr->value, builder);
+
+  builder.end_feature();
+}
+
+// Walks the features of a FeatureCollection.
+template<typename Value, typename Builder>
+void build_collection(const Value &json, Builder &builder) {
+  const auto &features_itr = json.FindMember("features");
+  if (features_itr == json.MemberEnd())
+    throw error("FeatureCollection must have features property");
+  if (!features_itr->value.IsArray())
+    throw error("FeatureCollection features property must be an array");
+
+  builder.begin_collection(features_itr->value.Size());
+  for (const auto &f : features_itr->value.GetArray())
+    build_feature(f, builder);
+  builder.end_collection();
+}
+
+// Walks a FeatureCollection, a Feature or a geometry.
+template<typename Value, typename Builder>
+void build(const Value &json, Builder &builder) {
+  if (!json.IsObject())
+    throw error("GeoJSON must be an object");
+
+  const auto &type_itr = json.FindMember("type");
+  if (type_itr == json.MemberEnd())
+    throw error("GeoJSON must have a type property");
+
+  if (type_itr->value == "FeatureCollection")
+    build_collection(json, builder);
+  else if (type_itr->value == "Feature")
+    build_feature(json, builder);
+  else
+    build_geometry(json, builder);
+}
+
+NS_GEOJSON_END
+NS_GAGO_END
+
+#endif //  GEOJSON_CPP_GAGO_GEOJSON_BUILDER_H_
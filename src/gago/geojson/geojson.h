@@ -24,8 +24,13 @@
 #ifndef GEOJSON_CPP_GAGO_GEOJSON_GEOJSON_H_
 #define GEOJSON_CPP_GAGO_GEOJSON_GEOJSON_H_
 
+#include <cstddef>
+#include <functional>
+#include <stdexcept>
+
 #include <gago/macros.h>
 #include <gago/geometry.h>
+#include <gago/snapshot.h>
 
 
 NS_GAGO_BEGIN
@@ -40,9 +45,95 @@ using linestring = gago::geometry::linestring<double>;
 using multi_linestring = gago::geometry::multi_linestring<double>;
 using polygon = gago::geometry::polygon<double>;
 using multi_polygon = gago::geometry::multi_polygon<double>;
+using box = gago::geometry::box<double>;
 using geometry = gago::geometry::geometry<double>;
+using geometry_type = gago::geometry::geometry_type;
+using tagged_geometry = gago::geometry::tagged_geometry<double>;
+using gago::geometry::type_of;
+using gago::geometry::visit;
+using gago::geometry::for_each_point;
 using feature = gago::geometry::feature<double>;
 using feature_collection = gago::geometry::feature_collection<double>;
+using shared_geometry = gago::geometry::shared_geometry<double>;
+using shared_feature = gago::geometry::shared_feature<double>;
+using shared_feature_collection = gago::geometry::shared_feature_collection<double>;
+using collection_publisher = gago::snapshot_publisher<feature_collection>;
+using polygon_join = gago::geometry::polygon_join<double>;
+using topology = gago::geometry::topology;
+using gago::geometry::build_topology;
+using gago::geometry::to_features;
+using invalid_feature = gago::geometry::invalid_feature;
+using gago::geometry::find_invalid;
+using point_grid = gago::geometry::point_grid<double>;
+using packed_point_grid = gago::geometry::packed_point_grid<double>;
+using raster = gago::geometry::raster;
+using raster_mode = gago::geometry::raster_mode;
+using raster_options = gago::geometry::raster_options;
+using gago::geometry::rasterize;
+using memory_footprint = gago::geometry::memory_footprint;
+using gago::geometry::memory_usage;
+using gago::geometry::compact;
+using rtree_index = gago::geometry::rtree_index<double>;
+template<typename Index = gago::geometry::no_index<double>>
+using feature_store = gago::geometry::feature_store<double, Index>;
+using simplify_method = gago::geometry::simplify_method;
+using space_filling_curve = gago::geometry::space_filling_curve;
+using gago::geometry::spatial_order;
+using gago::geometry::spatial_sort;
+using gago::geometry::hilbert_key;
+using gago::geometry::z_order_key;
+
+using error = std::runtime_error;
+
+enum class bbox_policy {
+  // Leave feature::bbox empty.
+  IGNORE = 0,
+  // Compute the envelope while the coordinates are converted.
+  COMPUTE,
+  // Use the feature's own "bbox" member when present, otherwise compute.
+  // With convert_options::transform set the bbox is always computed.
+  PREFER_INPUT
+};
+
+enum class ring_validation {
+  // Take polygon rings as they are.
+  NONE = 0,
+  // Throw an error for unclosed rings, rings of fewer than four positions
+  // and, when an orientation is requested, rings wound the other way.
+  CHECK,
+  // Close unclosed rings and rewind rings to the requested orientation;
+  // throw an error only for rings of fewer than four positions.
+  FIX
+};
+
+enum class ring_orientation {
+  // Leave the winding order alone.
+  KEEP = 0,
+  // Outer rings counterclockwise, holes clockwise, as RFC 7946 requires.
+  COUNTERCLOCKWISE,
+  // Outer rings clockwise, holes counterclockwise, as the polygon model and
+  // boost::geometry algorithms expect.
+  CLOCKWISE
+};
+
+struct convert_options {
+  // Simplify every linestring and polygon ring as soon as it is converted.
+  // Disabled while the tolerance is zero.
+  double simplify_tolerance = 0;
+  simplify_method simplify = simplify_method::DOUGLAS_PEUCKER;
+  bbox_policy bbox = bbox_policy::IGNORE;
+  // Also record feature::part_bboxes for MultiPoint, MultiLineString and
+  // MultiPolygon.
+  bool part_bboxes = false;
+  // Applied in place to every array of coordinates right after it is
+  // converted, before simplification and bounding boxes. See the
+  // transforms in gago/geometry/projection.h.
+  std::function<void(point *points, std::size_t count)> transform;
+  // Checked or fixed while each polygon ring is converted, before it is
+  // simplified. Without validation a requested orientation is still fixed.
+  ring_validation validation = ring_validation::NONE;
+  ring_orientation orientation = ring_orientation::KEEP;
+};
 
 template<class T>
 T parse(const std::string &);
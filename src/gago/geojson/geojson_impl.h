@@ -25,67 +25,89 @@
 
 #include <vector>
 #include <string>
+#include <algorithm>
 #include <stdexcept>
+#include <functional>
+#include <type_traits>
 #include <unordered_map>
+#include <experimental/optional>
 
 #include <rapidjson/document.h>
 #include <rapidjson/writer.h>
 #include <rapidjson/stringbuffer.h>
 #include <rapidjson/error/en.h>
 #include <boost/variant.hpp>
-#include <boost/geometry/algorithms/assign.hpp>
 
 #include <gago/macros.h>
 #include <gago/geojson/geojson.h>
 #include <gago/geojson/rapid_json.h>
+#include <gago/geojson/builder.h>
 
 NS_GAGO_BEGIN
 NS_GEOJSON_BEGIN
 
-using error = std::runtime_error;
 using prop_map = std::unordered_map<std::string, value>;
+using bounds = gago::geometry::bounds<double>;
 
 template<typename T>
-T convert(const rapidjson_value &json);
-
-template<>
-point convert<point>(const rapidjson_value &json) {
-  if (json.Size() < 2)
-    throw error("coordinates array must have at least 2 numbers");
-
-  return point(json[0].GetDouble(), json[1].GetDouble());
-}
+T convert(const rapidjson_value &json,
+          const convert_options &options = convert_options{});
 
 template<typename Container>
-Container convert(const rapidjson_value &json) {
+Container convert(const rapidjson_value &json, const convert_options &options) {
   Container container;
   auto size = json.Size();
   container.reserve(size);
 
   for (auto &element : json.GetArray()) {
-    container.push_back(convert<typename Container::value_type>(element));
+    container.push_back(convert<typename Container::value_type>(element, options));
   }
   return container;
 }
 
-template <>
-value convert<value>(const rapidjson_value &json);
-
-template <>
-prop_map convert(const rapidjson_value &json) {
-  if (!json.IsObject())
-    throw error("properties must be an object");
-
-  prop_map result;
-  for (auto &member : json.GetObject()) {
-    result.emplace(std::string(member.name.GetString(), member.name.GetStringLength()),
-                   convert<value>(member.value));
+// Applies convert_options::validation and orientation to a ring.
+template<typename Range>
+void check_ring(Range &ring, const convert_options &options, bool outer) {
+  if (ring.empty())
+    return;
+
+  if (options.validation != ring_validation::NONE) {
+    const auto &first = ring.front(), &last = ring.back();
+    if (first.x() != last.x() || first.y() != last.y()) {
+      if (options.validation == ring_validation::CHECK)
+        throw error("Polygon rings must be closed");
+      ring.push_back(ring.front());
+    }
+    if (ring.size() < 4)
+      throw error("Polygon rings must have at least 4 positions");
   }
-  return result;
+
+  if (options.orientation == ring_orientation::KEEP)
+    return;
+
+  // Twice the signed area; positive for counterclockwise rings. The
+  // closing edge counts for rings left open, and is zero for closed ones.
+  double area = 0;
+  for (std::size_t i = 1; i < ring.size(); i++)
+    area += ring[i - 1].x() * ring[i].y() - ring[i].x() * ring[i - 1].y();
+  area += ring.back().x() * ring.front().y() - ring.front().x() * ring.back().y();
+
+  bool counterclockwise = (options.orientation == ring_orientation::COUNTERCLOCKWISE) == outer;
+  if (area == 0 || (area > 0) == counterclockwise)
+    return;
+  if (options.validation == ring_validation::CHECK)
+    throw error(outer ? "Polygon outer ring has the wrong orientation"
+                      : "Polygon hole has the wrong orientation");
+  std::reverse(ring.begin(), ring.end());
 }
 
-template <>
-value convert<value>(const rapidjson_value &json) {
+namespace detail {
+
+// Conversions of any rapidjson GenericValue; the convert<T>
+// specializations below apply them to rapidjson_value.
+
+template<typename Value>
+value to_value(const Value &json) {
   switch (json.GetType()) {
     case rapidjson::kNullType:
       return null_value_t{};
@@ -93,10 +115,20 @@ value convert<value>(const rapidjson_value &json) {
       return false;
     case rapidjson::kTrueType:
       return true;
-    case rapidjson::kObjectType:
-      return convert<prop_map>(json);
-    case rapidjson::kArrayType:
-      return convert<std::vector<value>>(json);
+    case rapidjson::kObjectType: {
+      prop_map result;
+      for (auto &member : json.GetObject())
+        result.emplace(std::string(member.name.GetString(), member.name.GetStringLength()),
+                       to_value(member.value));
+      return result;
+    }
+    case rapidjson::kArrayType: {
+      std::vector<value> result;
+      result.reserve(json.Size());
+      for (auto &element : json.GetArray())
+        result.push_back(to_value(element));
+      return result;
+    }
     case rapidjson::kStringType:
       return std::string(json.GetString(), json.GetStringLength());
     default:
@@ -109,8 +141,21 @@ value convert<value>(const rapidjson_value &json) {
   }
 }
 
-template <>
-identifier convert<identifier>(const rapidjson_value &json) {
+// Converts into an existing value, reusing the storage of a string it
+// already holds.
+template<typename Value>
+void to_value(const Value &json, value &v) {
+  if (json.IsString()) {
+    if (auto s = boost::get<std::string>(&v)) {
+      s->assign(json.GetString(), json.GetStringLength());
+      return;
+    }
+  }
+  v = to_value(json);
+}
+
+template<typename Value>
+identifier to_identifier(const Value &json) {
   switch (json.GetType()) {
     case rapidjson::kStringType:
       return std::string(json.GetString(), json.GetStringLength());
@@ -125,142 +170,478 @@ identifier convert<identifier>(const rapidjson_value &json) {
   }
 }
 
-
-template<>
-polygon convert(const rapidjson_value &json) {
-  polygon p;
-  multi_linestring linestrings;
-  auto size = json.Size();
-  linestrings.reserve(size);
+template<typename Value>
+box to_box(const Value &json) {
+  if (!json.IsArray() || (json.Size() != 4 && json.Size() != 6))
+    throw error("bbox must be an array of 4 or 6 numbers");
 
   for (auto &element : json.GetArray()) {
-    linestrings.push_back(convert<linestring>(element));
+    if (!element.IsNumber())
+      throw error("bbox must be an array of 4 or 6 numbers");
   }
 
-  boost::geometry::assign_points(p.outer(), linestrings[0]);
-  for (int i = 1; i < size; i++)
-    boost::geometry::assign_points(p.inners()[i - 1], linestrings[i]);
+  auto max = json.Size() / 2;
+  return box(point(json[0].GetDouble(), json[1].GetDouble()),
+             point(json[max].GetDouble(), json[max + 1].GetDouble()));
+}
+
+}  // namespace detail
 
-  return p;
+template <>
+prop_map convert(const rapidjson_value &json, const convert_options &) {
+  if (!json.IsObject())
+    throw error("properties must be an object");
+  auto properties = detail::to_value(json);
+  return std::move(boost::get<prop_map>(properties));
+}
+
+template <>
+value convert<value>(const rapidjson_value &json, const convert_options &) {
+  return detail::to_value(json);
+}
+
+template <>
+identifier convert<identifier>(const rapidjson_value &json, const convert_options &) {
+  return detail::to_identifier(json);
 }
 
 template<>
-geometry convert<geometry>(const rapidjson_value &json) {
-  if (!json.IsObject())
-    throw error("Geometry must be an object");
+box convert<box>(const rapidjson_value &json, const convert_options &) {
+  return detail::to_box(json);
+}
 
-  const auto &json_end = json.MemberEnd();
+// The Builder of gago::geometry types of coordinate type T that the
+// converters below are made of; see builder.h. It applies convert_options
+// as the coordinates are read. A geometry outside any feature is left in
+// geometry(); features are appended to features(), or built into the
+// feature given to target(), reusing its geometry, property map and part
+// envelopes. The options are kept by reference.
+template<typename T = double>
+class geometry_builder {
+ public:
+  using point_type = gago::geometry::point<T>;
+  using box_type = gago::geometry::box<T>;
+  using feature_type = gago::geometry::feature<T>;
+  using collection_type = gago::geometry::feature_collection<T>;
+
+  geometry_builder() : options_(&default_options()) {}
+
+  explicit geometry_builder(const convert_options &options) : options_(&options) {}
+
+  // Builds the features that follow into `f`.
+  void target(feature_type &f) {
+    target_ = &f;
+  }
 
-  const auto &type_itr = json.FindMember("type");
-  if (type_itr == json_end)
-    throw error("Geometry must have a type property");
+  // Applies `options`, kept by reference, to what follows.
+  void options(const convert_options &options) {
+    options_ = &options;
+  }
 
-  const auto &type = type_itr->value;
+  void begin_collection(std::size_t features) {
+    if (!target_)
+      features_.reserve(features_.size() + features);
+  }
 
-  const auto &coords_itr = json.FindMember("coordinates");
+  void end_collection() {}
 
-  if (coords_itr == json_end)
-    throw error(std::string(type.GetString())
-                    + " geometry must have a coordinates property");
+  void begin_feature() {
+    if (target_) {
+      feature_ = target_;
+    } else {
+      features_.emplace_back(point_type());
+      feature_ = &features_.back();
+    }
+    feature_->id = std::experimental::nullopt;
+    feature_->bbox = std::experimental::nullopt;
+    feature_->part_bboxes.clear();
+    input_bbox_ = std::experimental::nullopt;
+    envelope_ = bounds_type();
+    compute_ = options_->bbox != bbox_policy::IGNORE;
+    seen_.clear();
+  }
 
-  const auto &json_coords = coords_itr->value;
-  if (!json_coords.IsArray())
-    throw error("coordinates property must be an array");
+  template<typename Value>
+  void id(const Value &json) {
+    feature_->id = detail::to_identifier(json);
+  }
 
-  if (type == "Point")
-    return convert<point>(json_coords);
-  if (type == "MultiPoint")
-    return convert<multi_point>(json_coords);
-  if (type == "LineString")
-    return convert<linestring>(json_coords);
-  if (type == "Polygon")
-    return convert<polygon>(json_coords);
-  if (type == "MultiPolygon")
-    return convert<multi_polygon>(json_coords);
+  template<typename Value>
+  void bbox(const Value &json) {
+    // The input bbox is in the source CRS; with a transform the envelope
+    // is computed from the transformed coordinates instead.
+    if (options_->bbox != bbox_policy::PREFER_INPUT || options_->transform)
+      return;
+
+    auto input = detail::to_box(json);
+    // A bbox crossing the antimeridian cannot be held in a box.
+    if (input.min_corner().x() > input.max_corner().x())
+      return;
+    input_bbox_ = box_type(point_type(T(input.min_corner().x()), T(input.min_corner().y())),
+                           point_type(T(input.max_corner().x()), T(input.max_corner().y())));
+    compute_ = false;
+  }
 
-  throw error(std::string(type.GetString()) + " not yet implemented");
-}
+  // Values of keys the feature already has are overwritten in place, so a
+  // stream of features with the same keys reuses the same map nodes. Keys
+  // are looked up through a reused string.
+  template<typename Value>
+  void property(const char *key, std::size_t length, const Value &json) {
+    auto &properties = feature_->properties;
+    key_.assign(key, length);
+    auto it = properties.find(key_);
+    if (it != properties.end())
+      detail::to_value(json, it->second);
+    else
+      it = properties.emplace(key_, detail::to_value(json)).first;
+    seen_.push_back(&it->second);
+  }
 
+  void null_geometry() {
+    throw error("Feature geometry must not be null");
+  }
 
-template <>
-feature convert<feature>(const rapidjson_value &json) {
-  if (!json.IsObject())
-    throw error("Feature must be an object");
+  void end_feature() {
+    // Erase the keys a reused feature had that this one lacks.
+    auto &properties = feature_->properties;
+    std::sort(seen_.begin(), seen_.end(), std::less<const value *>());
+    seen_.erase(std::unique(seen_.begin(), seen_.end()), seen_.end());
+    if (seen_.size() != properties.size()) {
+      for (auto it = properties.begin(); it != properties.end();) {
+        if (std::binary_search(seen_.begin(), seen_.end(), &it->second, std::less<const value *>()))
+          ++it;
+        else
+          it = properties.erase(it);
+      }
+    }
 
-  auto const &json_end = json.MemberEnd();
-  auto const &type_itr = json.FindMember("type");
+    if (input_bbox_)
+      feature_->bbox = *input_bbox_;
+    else if (compute_ && !envelope_.empty())
+      feature_->bbox = envelope_.to_box();
+    compute_ = false;
+    feature_ = nullptr;
+  }
 
-  if (type_itr == json_end)
-    throw error("Feature must have a type property");
-  if (type_itr->value != "Feature")
-    throw error("Feature type must be Feature");
+  void begin_geometry(geometry_type type, std::size_t parts) {
+    type_ = type;
+    geometry_target_ = feature_ ? &feature_->geometry : &geometry_;
+    part_ = 0;
+    parts_ = nullptr;
+    if (feature_ && options_->part_bboxes && (type == geometry_type::MULTIPOINT
+        || type == geometry_type::MULTILINESTRING || type == geometry_type::MULTIPOLYGON)) {
+      parts_ = &feature_->part_bboxes;
+      parts_->reserve(parts);
+    }
 
-  auto const &geom_itr = json.FindMember("geometry");
+    // Containers of a geometry of the same type are reused.
+    auto &g = *geometry_target_;
+    switch (type) {
+      case geometry_type::POINT:
+        reuse<point_type>(g);
+        break;
+      case geometry_type::MULTIPOINT: {
+        auto &points = reuse<gago::geometry::multi_point<T>>(g);
+        points.clear();
+        points.reserve(parts);
+        path_ = &points;
+        break;
+      }
+      case geometry_type::LINESTRING:
+        reuse<gago::geometry::linestring<T>>(g);
+        break;
+      case geometry_type::MULTILINESTRING:
+        reuse<gago::geometry::multi_linestring<T>>(g).resize(parts);
+        break;
+      case geometry_type::POLYGON:
+        reuse<gago::geometry::polygon<T>>(g);
+        break;
+      case geometry_type::MULTIPOLYGON:
+        reuse<gago::geometry::multi_polygon<T>>(g).resize(parts);
+        break;
+    }
+  }
 
-  if (geom_itr == json_end)
-    throw error("Feature must have a geometry property");
+  void end_geometry() {
+    if (type_ == geometry_type::MULTIPOINT) {
+      transform(*path_);
+      for (const auto &p : *path_) {
+        if (compute_)
+          envelope_.expand(p);
+        if (parts_)
+          parts_->emplace_back(p, p);
+      }
+    }
+    path_ = nullptr;
+    geometry_target_ = nullptr;
+  }
 
-  feature result{ convert<geometry>(geom_itr->value) };
+  void begin_polygon(std::size_t rings) {
+    if (type_ == geometry_type::MULTIPOLYGON)
+      polygon_ = &boost::get<gago::geometry::multi_polygon<T>>(*geometry_target_)[part_++];
+    else
+      polygon_ = &boost::get<gago::geometry::polygon<T>>(*geometry_target_);
 
-  auto const &id_itr = json.FindMember("id");
-  if (id_itr != json_end) {
-    result.id = convert<identifier>(id_itr->value);
+    polygon_->outer().clear();
+    polygon_->inners().resize(rings == 0 ? 0 : rings - 1);
+    ring_ = 0;
+    part_envelope_ = bounds_type();
   }
 
-  auto const &prop_itr = json.FindMember("properties");
-  if (prop_itr != json_end) {
-    const auto &json_props = prop_itr->value;
-    if (!json_props.IsNull()) {
-      result.properties = convert<prop_map>(json_props);
+  void end_polygon() {
+    // Holes lie inside the outer ring, so only the outer ring is bounded.
+    if (parts_)
+      parts_->push_back(part_envelope_.to_box());
+    if (compute_)
+      envelope_.expand(part_envelope_);
+    polygon_ = nullptr;
+  }
+
+  void begin_path(std::size_t positions) {
+    if (polygon_) {
+      path_ = ring_ == 0 ? &polygon_->outer() : &polygon_->inners()[ring_ - 1];
+      ring_++;
+    } else if (type_ == geometry_type::MULTILINESTRING) {
+      path_ = &boost::get<gago::geometry::multi_linestring<T>>(*geometry_target_)[part_++];
+      part_envelope_ = bounds_type();
+    } else {
+      path_ = &boost::get<gago::geometry::linestring<T>>(*geometry_target_);
     }
+    path_->clear();
+    path_->reserve(positions);
   }
 
-  return result;
+  void end_path() {
+    auto &points = *path_;
+    path_ = nullptr;
+    transform(points);
+
+    bool closed = polygon_ != nullptr;
+    if (closed)
+      check_ring(points, *options_, ring_ == 1);
+    // Bound only the points that survive simplification.
+    if (options_->simplify_tolerance > 0)
+      gago::geometry::simplify(points, options_->simplify_tolerance, options_->simplify, closed);
+
+    if (type_ == geometry_type::LINESTRING) {
+      if (compute_)
+        bound(points, envelope_);
+    } else if (type_ == geometry_type::MULTILINESTRING) {
+      if (compute_ || parts_)
+        bound(points, part_envelope_);
+      if (parts_)
+        parts_->push_back(part_envelope_.to_box());
+      if (compute_)
+        envelope_.expand(part_envelope_);
+    } else if (ring_ == 1 && (compute_ || parts_)) {
+      bound(points, part_envelope_);
+    }
+  }
+
+  void position(double x, double y) {
+    // Paths of doubles are transformed as a whole once they are read.
+    if (options_->transform && (!path_ || !std::is_same<T, double>::value)) {
+      gago::geometry::point<double> p(x, y);
+      options_->transform(&p, 1);
+      x = p.x();
+      y = p.y();
+    }
+
+    if (path_) {
+      path_->emplace_back(T(x), T(y));
+      return;
+    }
+    auto &p = boost::get<point_type>(*geometry_target_);
+    p = point_type(T(x), T(y));
+    if (compute_)
+      envelope_.expand(p);
+  }
+
+  gago::geometry::geometry<T> &geometry() {
+    return geometry_;
+  }
+
+  collection_type &features() {
+    return features_;
+  }
+
+ private:
+  using bounds_type = gago::geometry::bounds<T>;
+
+  static const convert_options &default_options() {
+    static const convert_options options;
+    return options;
+  }
+
+  // The geometry held by `g` as a G, reusing it when it already is one.
+  template<typename G>
+  static G &reuse(gago::geometry::geometry<T> &g) {
+    if (auto held = boost::get<G>(&g))
+      return *held;
+    g = G();
+    return boost::get<G>(g);
+  }
+
+  void transform(std::vector<gago::geometry::point<double>> &points) {
+    if (options_->transform)
+      options_->transform(points.data(), points.size());
+  }
+
+  // Other coordinate types are transformed position by position.
+  template<typename Point>
+  void transform(std::vector<Point> &) {}
+
+  static void bound(const std::vector<point_type> &points, bounds_type &b) {
+    for (const auto &p : points)
+      b.expand(p);
+  }
+
+  const convert_options *options_;
+  gago::geometry::geometry<T> geometry_;
+  collection_type features_;
+  feature_type *target_ = nullptr;
+  feature_type *feature_ = nullptr;
+  std::experimental::optional<box_type> input_bbox_;
+  // Envelope of the feature, kept while `compute_` is set.
+  bounds_type envelope_;
+  bool compute_ = false;
+  // Property values set for the current feature.
+  std::vector<const value *> seen_;
+  std::string key_;
+
+  geometry_type type_ = geometry_type::POINT;
+  gago::geometry::geometry<T> *geometry_target_ = nullptr;
+  std::vector<box_type> *parts_ = nullptr;
+  // Envelope of the current part or polygon.
+  bounds_type part_envelope_;
+  std::size_t part_ = 0;
+  gago::geometry::polygon<T> *polygon_ = nullptr;
+  std::size_t ring_ = 0;
+  // Points of the linestring, ring or multi point being built.
+  std::vector<point_type> *path_ = nullptr;
+};
+
+// Converts the coordinates array of a geometry of the given type.
+template<typename G>
+G convert_coordinates(const rapidjson_value &json, geometry_type type, const convert_options &options) {
+  geometry_builder<> builder(options);
+  build_coordinates(json, type, builder);
+  return std::move(boost::get<G>(builder.geometry()));
+}
+
+template<>
+point convert<point>(const rapidjson_value &json, const convert_options &options) {
+  return convert_coordinates<point>(json, geometry_type::POINT, options);
+}
+
+template<>
+multi_point convert(const rapidjson_value &json, const convert_options &options) {
+  return convert_coordinates<multi_point>(json, geometry_type::MULTIPOINT, options);
+}
+
+template<>
+linestring convert(const rapidjson_value &json, const convert_options &options) {
+  return convert_coordinates<linestring>(json, geometry_type::LINESTRING, options);
 }
 
 template<>
-geojson convert<geojson>(const rapidjson_value &json) {
+multi_linestring convert(const rapidjson_value &json, const convert_options &options) {
+  return convert_coordinates<multi_linestring>(json, geometry_type::MULTILINESTRING, options);
+}
+
+template<>
+polygon convert(const rapidjson_value &json, const convert_options &options) {
+  return convert_coordinates<polygon>(json, geometry_type::POLYGON, options);
+}
+
+template<>
+multi_polygon convert(const rapidjson_value &json, const convert_options &options) {
+  return convert_coordinates<multi_polygon>(json, geometry_type::MULTIPOLYGON, options);
+}
+
+template<>
+geometry convert<geometry>(const rapidjson_value &json, const convert_options &options) {
+  geometry_builder<> builder(options);
+  build_geometry(json, builder);
+  return std::move(builder.geometry());
+}
+
+// Converts a Feature object into `f`, reusing its geometry, property map
+// and part envelopes; every member of `f` is overwritten or reset.
+template<typename Value>
+void convert_feature(const Value &json, feature &f, const convert_options &options) {
+  geometry_builder<> builder(options);
+  builder.target(f);
+  build_feature(json, builder);
+}
+
+template <>
+feature convert<feature>(const rapidjson_value &json, const convert_options &options) {
+  feature result{ point() };
+  convert_feature(json, result, options);
+  return result;
+}
+
+namespace detail {
+
+template<typename Value>
+geojson to_geojson(const Value &json, const convert_options &options) {
   if (!json.IsObject())
     throw error("GeoJSON must be an object");
 
   const auto &type_itr = json.FindMember("type");
-  const auto &json_end = json.MemberEnd();
-
-  if (type_itr == json_end)
+  if (type_itr == json.MemberEnd())
     throw error("GeoJSON must have a type property");
 
   const auto &type = type_itr->value;
+  geometry_builder<> builder(options);
 
   if (type == "FeatureCollection") {
-    const auto &features_itr = json.FindMember("features");
-    if (features_itr == json_end)
-      throw error("FeatureCollection must have features property");
+    build_collection(json, builder);
+    return std::move(builder.features());
+  }
 
-    const auto &json_features = features_itr->value;
+  if (type == "Feature") {
+    build_feature(json, builder);
+    return std::move(builder.features().front());
+  }
 
-    if (!json_features.IsArray())
-      throw error("FeatureCollection features property must be an array");
+  build_geometry(json, builder);
+  return std::move(builder.geometry());
+}
 
-    feature_collection collection;
+}  // namespace detail
 
-    const auto &size = json_features.Size();
-    collection.reserve(size);
+template<>
+geojson convert<geojson>(const rapidjson_value &json, const convert_options &options) {
+  return detail::to_geojson(json, options);
+}
 
-    for (auto &feature_obj : json_features.GetArray()) {
-      collection.push_back(convert<feature>(feature_obj));
-    }
+template<>
+shared_feature convert<shared_feature>(const rapidjson_value &json, const convert_options &options) {
+  return shared_feature(convert<feature>(json, options));
+}
 
-    return collection;
-  }
+template<>
+shared_feature_collection convert<shared_feature_collection>(const rapidjson_value &json,
+                                                             const convert_options &options) {
+  if (!json.IsObject())
+    throw error("FeatureCollection must be an object");
 
-  if (type == "Feature")
-    return convert<feature>(json);
+  const auto &type_itr = json.FindMember("type");
+  if (type_itr == json.MemberEnd() || type_itr->value != "FeatureCollection")
+    throw error("FeatureCollection type must be FeatureCollection");
 
-  return convert<geometry>(json);
+  geometry_builder<> builder(options);
+  build_collection(json, builder);
+  return shared_feature_collection(std::move(builder.features()));
 }
 
-geojson convert(const rapidjson_value &json) {
-  return convert<geojson>(json);
+// Converts a FeatureCollection, a Feature or a geometry held in any
+// rapidjson GenericValue, such as the documents of parser_context.
+template<typename Value>
+geojson convert(const Value &json, const convert_options &options = convert_options{}) {
+  return detail::to_geojson(json, options);
 }
 
 NS_GEOJSON_END
@@ -0,0 +1,233 @@
+//
+// Copyright (c) 2018 ChuiZi (wuqinchun at gagogroup.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef GEOJSON_CPP_GAGO_GEOJSON_INGEST_H_
+#define GEOJSON_CPP_GAGO_GEOJSON_INGEST_H_
+
+#include <mutex>
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstddef>
+#include <utility>
+#include <algorithm>
+#include <exception>
+
+#include <boost/variant.hpp>
+
+#include <gago/macros.h>
+#include <gago/parallel.h>
+#include <gago/bounded_queue.h>
+#include <gago/geojson/geojson.h>
+#include <gago/geojson/rapid_json.h>
+#include <gago/geojson/geojson_impl.h>
+#include <gago/geojson/parser_context.h>
+
+NS_GAGO_BEGIN
+NS_GEOJSON_BEGIN
+
+struct ingest_options {
+  // Threads reading files.
+  std::size_t readers = 2;
+  // Threads parsing and converting; zero means one per hardware thread.
+  std::size_t parsers = 0;
+  // Files buffered between the stages; bounds memory and applies
+  // backpressure to the faster stage.
+  std::size_t queue_size = 8;
+  convert_options convert;
+};
+
+struct ingest_result {
+  // Position of the file in the input list.
+  std::size_t index = 0;
+  std::string path;
+  // A Feature becomes a collection of one, a bare geometry a feature
+  // without properties.
+  feature_collection features;
+  // Why the file failed, empty on success.
+  std::string error;
+
+  bool ok() const {
+    return error.empty();
+  }
+};
+
+namespace detail {
+
+struct ingest_text {
+  std::size_t index;
+  std::string text;
+  std::string error;
+};
+
+inline std::string read_file(const std::string &path) {
+  auto file = std::fopen(path.c_str(), "rb");
+  if (!file)
+    throw error("cannot open " + path);
+
+  std::string text;
+  char buffer[65536];
+  std::size_t n;
+  while ((n = std::fread(buffer, 1, sizeof(buffer), file)) > 0)
+    text.append(buffer, n);
+  bool failed = std::ferror(file) != 0;
+  std::fclose(file);
+  if (failed)
+    throw error("cannot read " + path);
+  return text;
+}
+
+inline feature_collection to_collection(geojson &&json) {
+  if (auto collection = boost::get<feature_collection>(&json))
+    return std::move(*collection);
+
+  feature_collection features;
+  if (auto f = boost::get<feature>(&json))
+    features.push_back(std::move(*f));
+  else
+    features.emplace_back(std::move(boost::get<geometry>(json)));
+  return features;
+}
+
+}  // namespace detail
+
+// Reads, parses and converts files in a pipeline: reader threads feed
+// file contents through a bounded queue to parser threads, each with its
+// own parser_context, whose results go through a second bounded queue to
+// the calling thread, which hands them to `f(ingest_result &&)` in
+// completion order. A file that cannot be read or parsed yields a result
+// with an error and does not stop the others. Anything else thrown, by `f`
+// or in a stage, shuts the pipeline down and is rethrown once every
+// started thread has been joined. Returns the number of failed files.
+template<typename F>
+std::size_t ingest(const std::vector<std::string> &paths, F &&f,
+                   const ingest_options &options = ingest_options{}) {
+  auto readers = std::max<std::size_t>(1, std::min(options.readers, paths.size()));
+  auto parsers = std::max<std::size_t>(1, std::min(thread_count(options.parsers), paths.size()));
+
+  bounded_queue<detail::ingest_text> texts(options.queue_size);
+  bounded_queue<ingest_result> results(options.queue_size);
+  std::atomic<std::size_t> next(0);
+  std::atomic<std::size_t> readers_left(readers), parsers_left(parsers);
+
+  // The first exception to escape; closing both queues stops every stage.
+  std::exception_ptr failure;
+  std::mutex failure_mutex;
+  auto fail = [&](std::exception_ptr e) {
+    {
+      std::lock_guard<std::mutex> lock(failure_mutex);
+      if (!failure)
+        failure = e;
+    }
+    texts.close();
+    results.close();
+  };
+
+  std::vector<std::thread> threads;
+  std::size_t failed = 0;
+  try {
+    threads.reserve(readers + parsers);
+    for (std::size_t i = 0; i < readers; i++) {
+      threads.emplace_back([&]() {
+        try {
+          for (std::size_t index; (index = next++) < paths.size();) {
+            detail::ingest_text item{index, {}, {}};
+            try {
+              item.text = detail::read_file(paths[index]);
+            } catch (const std::exception &e) {
+              item.error = e.what();
+            }
+            if (!texts.push(std::move(item)))
+              break;
+          }
+        } catch (...) {
+          fail(std::current_exception());
+        }
+        if (--readers_left == 0)
+          texts.close();
+      });
+    }
+
+    for (std::size_t i = 0; i < parsers; i++) {
+      threads.emplace_back([&]() {
+        try {
+          parser_context context;
+          detail::ingest_text item;
+          while (texts.pop(item)) {
+            ingest_result result;
+            result.index = item.index;
+            result.path = paths[item.index];
+            result.error = std::move(item.error);
+            if (result.ok()) {
+              try {
+                const auto &json = context.parse(item.text);
+                result.features = detail::to_collection(convert(json, options.convert));
+              } catch (const std::exception &e) {
+                result.error = e.what();
+              }
+            }
+            item.text = std::string();
+            if (!results.push(std::move(result)))
+              break;
+          }
+        } catch (...) {
+          fail(std::current_exception());
+        }
+        if (--parsers_left == 0)
+          results.close();
+      });
+    }
+
+    ingest_result result;
+    while (results.pop(result)) {
+      if (!result.ok())
+        failed++;
+      f(std::move(result));
+    }
+  } catch (...) {
+    fail(std::current_exception());
+  }
+
+  for (auto &t : threads)
+    t.join();
+  if (failure)
+    std::rethrow_exception(failure);
+  return failed;
+}
+
+// Same, collecting the results in input order.
+inline std::vector<ingest_result> ingest_all(const std::vector<std::string> &paths,
+                                             const ingest_options &options = ingest_options{}) {
+  std::vector<ingest_result> results(paths.size());
+  ingest(paths, [&results](ingest_result &&result) {
+    auto index = result.index;
+    results[index] = std::move(result);
+  }, options);
+  return results;
+}
+
+NS_GEOJSON_END
+NS_GAGO_END
+
+#endif //  GEOJSON_CPP_GAGO_GEOJSON_INGEST_H_
@@ -0,0 +1,145 @@
+//
+// Copyright (c) 2018 ChuiZi (wuqinchun at gagogroup.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef GEOJSON_CPP_GAGO_GEOJSON_PARSER_CONTEXT_H_
+#define GEOJSON_CPP_GAGO_GEOJSON_PARSER_CONTEXT_H_
+
+#include <string>
+#include <memory>
+#include <cstddef>
+
+#include <rapidjson/document.h>
+#include <rapidjson/error/en.h>
+
+#include <gago/macros.h>
+#include <gago/geojson/geojson.h>
+#include <gago/geojson/rapid_json.h>
+#include <gago/geojson/geojson_impl.h>
+
+NS_GAGO_BEGIN
+NS_GEOJSON_BEGIN
+
+// Parses many small documents one after another with as few allocations
+// as possible. The DOM and the parser stack live in two memory pools whose
+// first chunk is a buffer owned by the context; each parse resets the
+// pools instead of freeing them, and a parse that outgrows the buffers
+// makes them grow for the next one. Features are parsed into caller owned
+// instances whose containers are reused. The DOM has its own value type,
+// pool_value, which the converters and builder walks accept like
+// rapidjson_value.
+//
+// A context is not thread safe; give each thread its own, e.g. as a
+// thread_local.
+class parser_context {
+ public:
+  using pool_allocator = rapidjson::MemoryPoolAllocator<rapidjson::CrtAllocator>;
+  using pool_value = rapidjson::GenericValue<rapidjson::UTF8<>, pool_allocator>;
+
+  explicit parser_context(std::size_t buffer_size = 64 * 1024) {
+    allocate(buffer_size);
+  }
+
+  parser_context(const parser_context &) = delete;
+  parser_context &operator=(const parser_context &) = delete;
+
+  // Parses JSON text; the result stays valid until the next parse.
+  const pool_value &parse(const char *json, std::size_t length) {
+    reset();
+    document_->Parse(json, length);
+    if (document_->HasParseError()) {
+      throw error(std::string("JSON parse error at offset ")
+                      + std::to_string(document_->GetErrorOffset()) + ": "
+                      + rapidjson::GetParseError_En(document_->GetParseError()));
+    }
+    return *document_;
+  }
+
+  const pool_value &parse(const std::string &json) {
+    return parse(json.data(), json.size());
+  }
+
+  // Parses a Feature document into `f`, reusing its storage.
+  void parse(const char *json, std::size_t length, feature &f,
+             const convert_options &options = convert_options{}) {
+    const auto &document = parse(json, length);
+    builder_.options(options);
+    builder_.target(f);
+    build_feature(document, builder_);
+  }
+
+  void parse(const std::string &json, feature &f,
+             const convert_options &options = convert_options{}) {
+    parse(json.data(), json.size(), f, options);
+  }
+
+  std::size_t buffer_size() const {
+    return buffer_size_;
+  }
+
+ private:
+  using document_type = rapidjson::GenericDocument<rapidjson::UTF8<>,
+                                                   pool_allocator,
+                                                   pool_allocator>;
+
+  void allocate(std::size_t size) {
+    // The pools live in the buffers, so they go first.
+    document_.reset();
+    stack_.reset();
+    values_.reset();
+    buffer_size_ = size;
+    value_buffer_.reset(new char[size]);
+    stack_buffer_.reset(new char[size]);
+    values_.reset(new pool_allocator(value_buffer_.get(), size));
+    stack_.reset(new pool_allocator(stack_buffer_.get(), size));
+    document_.reset(new document_type(values_.get(), 1024, stack_.get()));
+  }
+
+  void reset() {
+    // Grow once the last document needed more than the buffers hold.
+    auto used = values_->Capacity() > stack_->Capacity() ? values_->Capacity() : stack_->Capacity();
+    if (used > buffer_size_) {
+      auto size = buffer_size_;
+      while (size < used)
+        size *= 2;
+      allocate(size);
+      return;
+    }
+
+    document_->SetNull();
+    values_->Clear();
+    stack_->Clear();
+  }
+
+  std::size_t buffer_size_ = 0;
+  std::unique_ptr<char[]> value_buffer_;
+  std::unique_ptr<char[]> stack_buffer_;
+  std::unique_ptr<pool_allocator> values_;
+  std::unique_ptr<pool_allocator> stack_;
+  std::unique_ptr<document_type> document_;
+  // Kept so that its scratch storage is reused.
+  geometry_builder<> builder_;
+};
+
+NS_GEOJSON_END
+NS_GAGO_END
+
+#endif //  GEOJSON_CPP_GAGO_GEOJSON_PARSER_CONTEXT_H_
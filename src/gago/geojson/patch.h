@@ -0,0 +1,102 @@
+//
+// Copyright (c) 2018 ChuiZi (wuqinchun at gagogroup.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef GEOJSON_CPP_GAGO_GEOJSON_PATCH_H_
+#define GEOJSON_CPP_GAGO_GEOJSON_PATCH_H_
+
+#include <cstddef>
+
+#include <gago/macros.h>
+#include <gago/geojson/geojson.h>
+#include <gago/geojson/rapid_json.h>
+#include <gago/geojson/geojson_impl.h>
+
+NS_GAGO_BEGIN
+NS_GEOJSON_BEGIN
+
+struct patch_stats {
+  std::size_t upserted = 0;
+  std::size_t erased = 0;
+};
+
+namespace detail {
+
+template<typename Index>
+void apply_feature_patch(feature_store<Index> &store,
+                         const rapidjson_value &json,
+                         const convert_options &options,
+                         patch_stats &stats) {
+  if (!json.IsObject())
+    throw error("Feature must be an object");
+
+  const auto &id_itr = json.FindMember("id");
+  if (id_itr == json.MemberEnd())
+    throw error("Patched features must have an id");
+
+  const auto &geom_itr = json.FindMember("geometry");
+  if (geom_itr != json.MemberEnd() && geom_itr->value.IsNull()) {
+    if (store.erase(convert<identifier>(id_itr->value, options)))
+      stats.erased++;
+    return;
+  }
+
+  store.upsert(convert<feature>(json, options));
+  stats.upserted++;
+}
+
+}  // namespace detail
+
+// Applies a GeoJSON fragment to a store: a Feature, or a FeatureCollection
+// of them applied in order. Every feature must have an id; a feature with
+// a null geometry deletes the stored feature with that id, any other
+// feature replaces it or is inserted.
+template<typename Index>
+patch_stats apply_patch(feature_store<Index> &store,
+                        const rapidjson_value &json,
+                        const convert_options &options = convert_options{}) {
+  if (!json.IsObject())
+    throw error("GeoJSON must be an object");
+
+  const auto &type_itr = json.FindMember("type");
+  if (type_itr == json.MemberEnd())
+    throw error("GeoJSON must have a type property");
+
+  patch_stats stats;
+  if (type_itr->value == "FeatureCollection") {
+    const auto &features_itr = json.FindMember("features");
+    if (features_itr == json.MemberEnd() || !features_itr->value.IsArray())
+      throw error("FeatureCollection features property must be an array");
+
+    for (const auto &f : features_itr->value.GetArray())
+      detail::apply_feature_patch(store, f, options, stats);
+  } else if (type_itr->value == "Feature") {
+    detail::apply_feature_patch(store, json, options, stats);
+  } else {
+    throw error("A patch must be a Feature or a FeatureCollection");
+  }
+  return stats;
+}
+
+NS_GEOJSON_END
+NS_GAGO_END
+
+#endif //  GEOJSON_CPP_GAGO_GEOJSON_PATCH_H_
@@ -0,0 +1,349 @@
+//
+// Copyright (c) 2018 ChuiZi (wuqinchun at gagogroup.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef GEOJSON_CPP_GAGO_GEOJSON_SUMMARY_H_
+#define GEOJSON_CPP_GAGO_GEOJSON_SUMMARY_H_
+
+#include <array>
+#include <cstdio>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <unordered_map>
+
+#include <rapidjson/reader.h>
+#include <rapidjson/memorystream.h>
+#include <rapidjson/filereadstream.h>
+#include <rapidjson/error/en.h>
+
+#include <gago/macros.h>
+#include <gago/geojson/geojson.h>
+
+NS_GAGO_BEGIN
+NS_GEOJSON_BEGIN
+
+// JSON types of property values, in the order of the value variant.
+enum class property_type {
+  NIL = 0,
+  BOOL,
+  UINT,
+  INT,
+  DOUBLE,
+  STRING,
+  VECTOR,
+  MAP
+};
+
+struct property_stats {
+  // Number of features with the key, by the type of its value.
+  std::array<std::size_t, 8> types{};
+
+  std::size_t count() const {
+    std::size_t n = 0;
+    for (auto t : types)
+      n += t;
+    return n;
+  }
+
+  std::size_t count(property_type type) const {
+    return types[std::size_t(type)];
+  }
+};
+
+struct geojson_summary {
+  std::size_t feature_collections = 0;
+  std::size_t features = 0;
+  // Features whose geometry is null.
+  std::size_t null_geometries = 0;
+  // Geometry objects by geometry_type.
+  std::array<std::size_t, 6> geometries{};
+  // Objects with any other "type", e.g. GeometryCollection.
+  std::size_t unknown_types = 0;
+  std::size_t positions = 0;
+  gago::geometry::bounds<double> extent;
+  // Top level members of feature properties, by key.
+  std::unordered_map<std::string, property_stats> properties;
+
+  std::size_t count(geometry_type type) const {
+    return geometries[std::size_t(type)];
+  }
+};
+
+namespace detail {
+
+// rapidjson SAX handler behind summarize(). Keeps a fixed stack of frames,
+// one per open object or array, and never builds values: positions are
+// counted and bounded as their numbers stream by, and property values are
+// only classified.
+class summary_handler {
+ public:
+  static constexpr std::size_t max_depth = 64;
+
+  explicit summary_handler(geojson_summary &summary) : summary_(summary) {}
+
+  bool Null() {
+    auto &p = parent();
+    if (p.region == region_normal && !p.array && p.key == key_geometry)
+      summary_.null_geometries++;
+    return scalar(property_type::NIL);
+  }
+
+  bool Bool(bool) {
+    return scalar(property_type::BOOL);
+  }
+
+  bool Int(int i) {
+    return number(i < 0 ? property_type::INT : property_type::UINT, i);
+  }
+
+  bool Uint(unsigned u) {
+    return number(property_type::UINT, u);
+  }
+
+  bool Int64(std::int64_t i) {
+    return number(i < 0 ? property_type::INT : property_type::UINT, double(i));
+  }
+
+  bool Uint64(std::uint64_t u) {
+    return number(property_type::UINT, double(u));
+  }
+
+  bool Double(double d) {
+    return number(property_type::DOUBLE, d);
+  }
+
+  bool RawNumber(const char *, rapidjson::SizeType, bool) {
+    return false;
+  }
+
+  bool String(const char *str, rapidjson::SizeType length, bool) {
+    auto &p = parent();
+    if (p.region == region_normal && p.key == key_type)
+      p.type = type_of_name(str, length);
+    return scalar(property_type::STRING);
+  }
+
+  bool Key(const char *str, rapidjson::SizeType length, bool) {
+    auto &p = parent();
+    p.key = key_other;
+    if (p.region == region_properties) {
+      // The map only copies the scratch key when it first sees it.
+      key_.assign(str, length);
+      p.property = &summary_.properties[key_];
+    } else if (p.region == region_normal) {
+      if (equals(str, length, "type"))
+        p.key = key_type;
+      else if (equals(str, length, "coordinates"))
+        p.key = key_coordinates;
+      else if (equals(str, length, "properties"))
+        p.key = key_properties;
+      else if (equals(str, length, "geometry"))
+        p.key = key_geometry;
+    }
+    return true;
+  }
+
+  bool StartObject() {
+    return open(false, property_type::MAP);
+  }
+
+  bool EndObject(rapidjson::SizeType) {
+    const auto &f = frames_[depth_ - 1];
+    switch (f.type) {
+      case type_none:
+        break;
+      case type_feature:
+        summary_.features++;
+        break;
+      case type_feature_collection:
+        summary_.feature_collections++;
+        break;
+      case type_unknown:
+        summary_.unknown_types++;
+        break;
+      default:
+        summary_.geometries[f.type]++;
+        break;
+    }
+    depth_--;
+    return true;
+  }
+
+  bool StartArray() {
+    return open(true, property_type::VECTOR);
+  }
+
+  bool EndArray(rapidjson::SizeType) {
+    const auto &f = frames_[depth_ - 1];
+    if (f.region == region_coordinates && f.numbers >= 2) {
+      summary_.positions++;
+      summary_.extent.expand(f.x, f.y);
+    }
+    depth_--;
+    return true;
+  }
+
+ private:
+  enum : std::uint8_t {
+    region_normal,
+    region_coordinates,
+    region_properties,
+    region_skip
+  };
+
+  enum : std::uint8_t {
+    key_other,
+    key_type,
+    key_coordinates,
+    key_properties,
+    key_geometry
+  };
+
+  // Geometry types are their geometry_type values.
+  enum : std::uint8_t {
+    type_feature = 6,
+    type_feature_collection,
+    type_unknown,
+    type_none
+  };
+
+  struct frame {
+    bool array;
+    std::uint8_t region;
+    std::uint8_t key;
+    std::uint8_t type;
+    std::uint32_t numbers;
+    double x, y;
+    property_stats *property;
+  };
+
+  template<std::size_t N>
+  static bool equals(const char *str, rapidjson::SizeType length, const char (&name)[N]) {
+    return length == N - 1 && std::memcmp(str, name, N - 1) == 0;
+  }
+
+  static std::uint8_t type_of_name(const char *str, rapidjson::SizeType length) {
+    static const char *names[] = {"Point", "MultiPoint", "LineString", "MultiLineString",
+                                  "Polygon", "MultiPolygon", "Feature", "FeatureCollection"};
+    for (std::uint8_t i = 0; i < 8; i++) {
+      if (std::strlen(names[i]) == length && std::memcmp(names[i], str, length) == 0)
+        return i;
+    }
+    return type_unknown;
+  }
+
+  // Frame of the innermost open container, or of the document root.
+  frame &parent() {
+    return depth_ == 0 ? root_ : frames_[depth_ - 1];
+  }
+
+  void classify(frame &p, property_type type) {
+    if (p.region == region_properties && !p.array && p.property)
+      p.property->types[std::size_t(type)]++;
+  }
+
+  bool scalar(property_type type) {
+    classify(parent(), type);
+    return true;
+  }
+
+  bool number(property_type type, double d) {
+    auto &p = parent();
+    if (p.region == region_coordinates && p.array) {
+      if (p.numbers == 0)
+        p.x = d;
+      else if (p.numbers == 1)
+        p.y = d;
+      p.numbers++;
+    }
+    return scalar(type);
+  }
+
+  bool open(bool array, property_type type) {
+    if (depth_ == max_depth)
+      return false;
+
+    auto &p = parent();
+    classify(p, type);
+
+    std::uint8_t region = region_normal;
+    if (p.region == region_coordinates) {
+      region = region_coordinates;
+    } else if (p.region == region_properties || p.region == region_skip) {
+      region = region_skip;
+    } else if (!p.array && p.key == key_coordinates && array) {
+      region = region_coordinates;
+    } else if (!p.array && p.key == key_properties && !array) {
+      region = region_properties;
+    }
+
+    frames_[depth_++] = frame{array, region, key_other, type_none, 0, 0, 0, nullptr};
+    return true;
+  }
+
+  geojson_summary &summary_;
+  frame root_{true, region_normal, key_other, type_none, 0, 0, 0, nullptr};
+  std::array<frame, max_depth> frames_;
+  std::size_t depth_ = 0;
+  std::string key_;
+};
+
+template<typename Stream>
+geojson_summary summarize_stream(Stream &stream) {
+  geojson_summary summary;
+  summary_handler handler(summary);
+  rapidjson::Reader reader;
+  auto result = reader.Parse(stream, handler);
+  if (result.IsError()) {
+    throw error(std::string("GeoJSON summary failed at offset ")
+                    + std::to_string(result.Offset()) + ": "
+                    + rapidjson::GetParseError_En(result.Code()));
+  }
+  return summary;
+}
+
+}  // namespace detail
+
+// Counts features and geometries by type, positions, the overall extent
+// and the keys and value types of feature properties in one streaming
+// pass, without building any geometry or property value.
+inline geojson_summary summarize(const char *json, std::size_t length) {
+  rapidjson::MemoryStream stream(json, length);
+  return detail::summarize_stream(stream);
+}
+
+inline geojson_summary summarize(const std::string &json) {
+  return summarize(json.data(), json.size());
+}
+
+// Same, reading the file through a fixed buffer.
+inline geojson_summary summarize(std::FILE *file) {
+  char buffer[65536];
+  rapidjson::FileReadStream stream(file, buffer, sizeof(buffer));
+  return detail::summarize_stream(stream);
+}
+
+NS_GEOJSON_END
+NS_GAGO_END
+
+#endif //  GEOJSON_CPP_GAGO_GEOJSON_SUMMARY_H_
@@ -0,0 +1,592 @@
+//
+// Copyright (c) 2018 ChuiZi (wuqinchun at gagogroup.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef GEOJSON_CPP_GAGO_GEOJSON_TILE_INDEX_H_
+#define GEOJSON_CPP_GAGO_GEOJSON_TILE_INDEX_H_
+
+#include <list>
+#include <array>
+#include <cmath>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <boost/geometry/algorithms/envelope.hpp>
+#include <boost/geometry/algorithms/num_points.hpp>
+
+#include <gago/macros.h>
+#include <gago/geometry/simplify.h>
+#include <gago/geojson/geojson.h>
+
+NS_GAGO_BEGIN
+NS_GEOJSON_BEGIN
+
+struct tile_options {
+  // Highest zoom tiles are generated for; geometries are not simplified there.
+  // At most 29, as tile keys pack x and y in 29 bits each.
+  std::uint8_t max_zoom = 14;
+  // Tiles up to this zoom are split eagerly when the index is built,
+  // unless they hold no more than `index_max_points` points.
+  std::uint8_t index_max_zoom = 5;
+  std::uint32_t index_max_points = 100000;
+  // Simplification tolerance, in tile pixels.
+  double tolerance = 3;
+  std::uint16_t extent = 4096;
+  // Tile buffer on each side, in tile pixels. `extent + buffer` must fit in
+  // the int16 tile coordinates.
+  std::uint16_t buffer = 64;
+  // Number of tiles below the eager index kept in the LRU cache.
+  std::size_t cache_size = 256;
+};
+
+using tile_point = gago::geometry::point<std::int16_t>;
+using tile_geometry = gago::geometry::geometry<std::int16_t>;
+using tile_feature = gago::geometry::feature<std::int16_t>;
+using tile = gago::geometry::feature_collection<std::int16_t>;
+
+namespace detail {
+
+// A feature clipped to a tile, in Web Mercator coordinates scaled to [0, 1].
+struct tile_source {
+  tagged_geometry geom;
+  std::size_t index;
+  std::size_t points;
+  box bbox;
+};
+
+using tile_sources = std::vector<tile_source>;
+
+inline point project(const point &p) {
+  auto sine = std::sin(p.y() * M_PI / 180);
+  auto y = 0.5 - 0.25 * std::log((1 + sine) / (1 - sine)) / M_PI;
+  return point(p.x() / 360 + 0.5, y < 0 ? 0 : y > 1 ? 1 : y);
+}
+
+inline tagged_geometry project(const geometry &g) {
+  tagged_geometry projected(g);
+  gago::geometry::for_each_point(projected, [](point &p) { p = project(p); });
+  return projected;
+}
+
+// Clips geometries to the band k1 <= coordinate <= k2 along one axis.
+template<std::size_t Axis>
+struct clipper {
+  double k1;
+  double k2;
+
+  clipper(double k1_, double k2_) : k1(k1_), k2(k2_) {}
+
+  static double get(const point &p) {
+    return boost::geometry::get<Axis>(p);
+  }
+
+  static point intersect(const point &a, const point &b, double k) {
+    auto t = (k - get(a)) / (get(b) - get(a));
+    point p(a.x() + (b.x() - a.x()) * t, a.y() + (b.y() - a.y()) * t);
+    boost::geometry::set<Axis>(p, k);
+    return p;
+  }
+
+  bool inside(const point &p) const {
+    return get(p) >= k1 && get(p) <= k2;
+  }
+
+  // Shared by lines and rings: rings stay in one piece, lines are cut into
+  // a new part every time they leave the band.
+  template<typename Range, typename Output>
+  void clip_range(const Range &range, Output &output, bool closed) const {
+    typename Output::value_type slice;
+
+    auto flush = [&]() {
+      if (!closed && slice.size() >= 2)
+        output.push_back(std::move(slice));
+      if (!closed)
+        slice = typename Output::value_type();
+    };
+
+    for (std::size_t i = 0; i + 1 < range.size(); i++) {
+      const auto &a = range[i];
+      const auto &b = range[i + 1];
+      auto ak = get(a), bk = get(b);
+
+      if (ak < k1) {
+        if (bk > k1) {
+          slice.push_back(intersect(a, b, k1));
+          if (bk > k2) {
+            slice.push_back(intersect(a, b, k2));
+            flush();
+          }
+        }
+      } else if (ak > k2) {
+        if (bk < k2) {
+          slice.push_back(intersect(a, b, k2));
+          if (bk < k1) {
+            slice.push_back(intersect(a, b, k1));
+            flush();
+          }
+        }
+      } else {
+        slice.push_back(a);
+        if (bk < k1) {
+          slice.push_back(intersect(a, b, k1));
+          flush();
+        } else if (bk > k2) {
+          slice.push_back(intersect(a, b, k2));
+          flush();
+        }
+      }
+    }
+
+    if (!range.empty() && inside(range.back()))
+      slice.push_back(range.back());
+
+    if (closed) {
+      if (!slice.empty() && (slice.front().x() != slice.back().x()
+          || slice.front().y() != slice.back().y()))
+        slice.push_back(slice.front());
+      if (slice.size() >= 4)
+        output.push_back(std::move(slice));
+    } else {
+      flush();
+    }
+  }
+
+  void clip_polygon(const polygon &p, multi_polygon &output) const {
+    std::vector<polygon::ring_type> rings;
+    clip_range(p.outer(), rings, true);
+    if (rings.empty())
+      return;
+
+    polygon result;
+    result.outer() = std::move(rings.front());
+    for (const auto &ring : p.inners())
+      clip_range(ring, result.inners(), true);
+    output.push_back(std::move(result));
+  }
+
+  tagged_geometry operator()(const point &p) const {
+    if (inside(p))
+      return p;
+    return multi_point();
+  }
+
+  tagged_geometry operator()(const multi_point &g) const {
+    multi_point result;
+    for (const auto &p : g)
+      if (inside(p))
+        result.push_back(p);
+    return result;
+  }
+
+  tagged_geometry operator()(const linestring &g) const {
+    multi_linestring result;
+    clip_range(g, result, false);
+    if (result.size() == 1)
+      return std::move(result.front());
+    return result;
+  }
+
+  tagged_geometry operator()(const multi_linestring &g) const {
+    multi_linestring result;
+    for (const auto &line : g)
+      clip_range(line, result, false);
+    return result;
+  }
+
+  tagged_geometry operator()(const polygon &g) const {
+    multi_polygon result;
+    clip_polygon(g, result);
+    if (result.size() == 1)
+      return std::move(result.front());
+    return result;
+  }
+
+  tagged_geometry operator()(const multi_polygon &g) const {
+    multi_polygon result;
+    for (const auto &p : g)
+      clip_polygon(p, result);
+    return result;
+  }
+};
+
+// Converts projected geometries into simplified tile pixel coordinates.
+struct tile_renderer {
+  double z2;
+  double tx;
+  double ty;
+  double extent;
+  double tolerance;
+
+  tile_point transform(const point &p) const {
+    return tile_point(std::int16_t(std::round(extent * (p.x() * z2 - tx))),
+                      std::int16_t(std::round(extent * (p.y() * z2 - ty))));
+  }
+
+  template<typename Output, typename Range>
+  Output transform_range(const Range &range, bool closed) const {
+    Output result;
+    auto simplified = range;
+    gago::geometry::simplify(simplified, tolerance,
+                             gago::geometry::simplify_method::DOUGLAS_PEUCKER,
+                             closed);
+    if (simplified.size() < (closed ? 4u : 2u))
+      return result;
+
+    result.reserve(simplified.size());
+    for (const auto &p : simplified)
+      result.push_back(transform(p));
+    return result;
+  }
+
+  template<typename Polygon>
+  Polygon transform_polygon(const polygon &p) const {
+    Polygon result;
+    result.outer() = transform_range<typename Polygon::ring_type>(p.outer(), true);
+    if (result.outer().empty())
+      return result;
+
+    for (const auto &ring : p.inners()) {
+      auto inner = transform_range<typename Polygon::ring_type>(ring, true);
+      if (!inner.empty())
+        result.inners().push_back(std::move(inner));
+    }
+    return result;
+  }
+
+  tile_geometry operator()(const point &p) const {
+    return transform(p);
+  }
+
+  tile_geometry operator()(const multi_point &g) const {
+    gago::geometry::multi_point<std::int16_t> result;
+    result.reserve(g.size());
+    for (const auto &p : g)
+      result.push_back(transform(p));
+    return result;
+  }
+
+  tile_geometry operator()(const linestring &g) const {
+    return transform_range<gago::geometry::linestring<std::int16_t>>(g, false);
+  }
+
+  tile_geometry operator()(const multi_linestring &g) const {
+    gago::geometry::multi_linestring<std::int16_t> result;
+    for (const auto &line : g) {
+      auto part = transform_range<gago::geometry::linestring<std::int16_t>>(line, false);
+      if (!part.empty())
+        result.push_back(std::move(part));
+    }
+    return result;
+  }
+
+  tile_geometry operator()(const polygon &g) const {
+    return transform_polygon<gago::geometry::polygon<std::int16_t>>(g);
+  }
+
+  tile_geometry operator()(const multi_polygon &g) const {
+    gago::geometry::multi_polygon<std::int16_t> result;
+    for (const auto &p : g) {
+      auto part = transform_polygon<gago::geometry::polygon<std::int16_t>>(p);
+      if (!part.outer().empty())
+        result.push_back(std::move(part));
+    }
+    return result;
+  }
+};
+
+template<typename Geometry>
+std::size_t count_points(const Geometry &g) {
+  return gago::geometry::visit(g, [](const auto &held) {
+    return std::size_t(boost::geometry::num_points(held));
+  });
+}
+
+inline box envelope(const tagged_geometry &g) {
+  return g.visit([](const auto &held) {
+    return boost::geometry::return_envelope<box>(held);
+  });
+}
+
+}  // namespace detail
+
+// Slices a feature collection into vector tiles in the style of geojson-vt.
+// Tiles up to `index_max_zoom` are clipped eagerly; deeper tiles are clipped
+// on demand from their closest ancestor and kept in an LRU cache. Returned
+// tiles use pixel coordinates within [0, extent), plus the buffer. A
+// tile_index is not safe to query from several threads at once.
+class tile_index {
+ public:
+  explicit tile_index(feature_collection features,
+                      tile_options options = tile_options{})
+      : features_(std::move(features)),
+        options_(options),
+        empty_(std::make_shared<const tile>()) {
+    if (options_.max_zoom > 29)
+      throw std::invalid_argument("Tile max_zoom exceeds 29");
+    if (std::uint32_t(options_.extent) + options_.buffer > 32767)
+      throw std::invalid_argument("Tile extent plus buffer exceeds 32767");
+    if (options_.cache_size < 4)
+      options_.cache_size = 4;
+
+    detail::tile_sources sources;
+    sources.reserve(features_.size());
+    for (std::size_t i = 0; i < features_.size(); i++) {
+      const auto &f = features_[i];
+      auto projected = detail::project(f.geometry);
+      if (!f.bbox) {
+        add_source(sources, std::move(projected), i);
+        continue;
+      }
+
+      // The projection is monotonic, so a cached bbox maps corner to corner.
+      auto min = detail::project(f.bbox->min_corner());
+      auto max = detail::project(f.bbox->max_corner());
+      auto points = detail::count_points(projected);
+      if (points > 0)
+        sources.push_back({std::move(projected), i, points,
+                           box(point(min.x(), max.y()), point(max.x(), min.y()))});
+    }
+    build_index(std::move(sources));
+  }
+
+  const feature_collection &features() const {
+    return features_;
+  }
+
+  std::shared_ptr<const tile> get_tile(std::uint8_t z, std::uint32_t x, std::uint32_t y) {
+    if (z > options_.max_zoom)
+      throw std::out_of_range("Tile zoom exceeds max_zoom");
+    if (x >= (std::uint64_t(1) << z) || y >= (std::uint64_t(1) << z))
+      throw std::out_of_range("Tile coordinates out of range");
+
+    auto index_itr = index_.find(key(z, x, y));
+    if (index_itr != index_.end()) {
+      auto &node = index_itr->second;
+      if (!node.rendered)
+        node.rendered = render(z, x, y, node.source);
+      return node.rendered;
+    }
+
+    if (auto *node = cache_find(key(z, x, y))) {
+      if (!node->rendered)
+        node->rendered = render(z, x, y, node->source);
+      return node->rendered;
+    }
+
+    for (auto zz = z; zz-- > 0;) {
+      auto ax = x >> (z - zz), ay = y >> (z - zz);
+      if (auto *node = cache_find(key(zz, ax, ay)))
+        return drill(zz, &node->source, z, x, y);
+
+      index_itr = index_.find(key(zz, ax, ay));
+      if (index_itr != index_.end()) {
+        if (index_itr->second.split)
+          return empty_;
+        return drill(zz, &index_itr->second.source, z, x, y);
+      }
+    }
+    return empty_;
+  }
+
+ private:
+  struct node {
+    detail::tile_sources source;
+    std::shared_ptr<const tile> rendered;
+    bool split = false;
+  };
+
+  using cache_list = std::list<std::pair<std::uint64_t, node>>;
+
+  static std::uint64_t key(std::uint8_t z, std::uint32_t x, std::uint32_t y) {
+    return (std::uint64_t(z) << 58) | (std::uint64_t(x) << 29) | y;
+  }
+
+  static void add_source(detail::tile_sources &sources, tagged_geometry geom, std::size_t index) {
+    auto points = detail::count_points(geom);
+    if (points == 0)
+      return;
+    auto bbox = detail::envelope(geom);
+    sources.push_back({std::move(geom), index, points, bbox});
+  }
+
+  template<std::size_t Axis>
+  static detail::tile_sources clip(const detail::tile_sources &sources, double k1, double k2) {
+    detail::tile_sources result;
+    detail::clipper<Axis> clipper(k1, k2);
+
+    for (const auto &source : sources) {
+      auto min = boost::geometry::get<boost::geometry::min_corner, Axis>(source.bbox);
+      auto max = boost::geometry::get<boost::geometry::max_corner, Axis>(source.bbox);
+
+      if (min >= k1 && max <= k2)
+        result.push_back(source);
+      else if (max >= k1 && min <= k2)
+        add_source(result, source.geom.visit(clipper), source.index);
+    }
+    return result;
+  }
+
+  // Children are ordered (2x, 2y), (2x, 2y + 1), (2x + 1, 2y), (2x + 1, 2y + 1).
+  std::array<detail::tile_sources, 4> split(std::uint8_t z, std::uint32_t x, std::uint32_t y,
+                                            const detail::tile_sources &sources) const {
+    double z2 = double(std::uint64_t(1) << (z + 1));
+    double k = double(options_.buffer) / options_.extent;
+    double cx = 2.0 * x, cy = 2.0 * y;
+
+    auto left = clip<0>(sources, (cx - k) / z2, (cx + 1 + k) / z2);
+    auto right = clip<0>(sources, (cx + 1 - k) / z2, (cx + 2 + k) / z2);
+
+    return {{
+        clip<1>(left, (cy - k) / z2, (cy + 1 + k) / z2),
+        clip<1>(left, (cy + 1 - k) / z2, (cy + 2 + k) / z2),
+        clip<1>(right, (cy - k) / z2, (cy + 1 + k) / z2),
+        clip<1>(right, (cy + 1 - k) / z2, (cy + 2 + k) / z2)
+    }};
+  }
+
+  void build_index(detail::tile_sources root) {
+    struct pending {
+      std::uint8_t z;
+      std::uint32_t x;
+      std::uint32_t y;
+      detail::tile_sources sources;
+    };
+
+    std::vector<pending> stack;
+    stack.push_back({0, 0, 0, std::move(root)});
+
+    while (!stack.empty()) {
+      auto item = std::move(stack.back());
+      stack.pop_back();
+
+      auto &node = index_[key(item.z, item.x, item.y)];
+
+      std::size_t points = 0;
+      for (const auto &source : item.sources)
+        points += source.points;
+
+      if (item.z >= options_.index_max_zoom || item.z >= options_.max_zoom
+          || points <= options_.index_max_points) {
+        node.source = std::move(item.sources);
+        continue;
+      }
+
+      // Split tiles only keep their rendered output.
+      node.rendered = render(item.z, item.x, item.y, item.sources);
+      node.split = true;
+
+      auto children = split(item.z, item.x, item.y, item.sources);
+      for (std::uint32_t i = 0; i < 4; i++) {
+        if (!children[i].empty())
+          stack.push_back({std::uint8_t(item.z + 1), 2 * item.x + (i >> 1),
+                           2 * item.y + (i & 1), std::move(children[i])});
+      }
+    }
+  }
+
+  std::shared_ptr<const tile> drill(std::uint8_t zz,
+                                    const detail::tile_sources *sources,
+                                    std::uint8_t z, std::uint32_t x, std::uint32_t y) {
+    while (zz < z) {
+      if (sources->empty())
+        return empty_;
+
+      auto ax = x >> (z - zz), ay = y >> (z - zz);
+      auto children = split(zz, ax, ay, *sources);
+      zz++;
+      for (std::uint32_t i = 0; i < 4; i++)
+        cache_insert(key(zz, 2 * ax + (i >> 1), 2 * ay + (i & 1)), std::move(children[i]));
+
+      sources = &cache_find(key(zz, x >> (z - zz), y >> (z - zz)))->source;
+    }
+
+    auto *node = cache_find(key(z, x, y));
+    node->rendered = render(z, x, y, node->source);
+    return node->rendered;
+  }
+
+  std::shared_ptr<const tile> render(std::uint8_t z, std::uint32_t x, std::uint32_t y,
+                                     const detail::tile_sources &sources) const {
+    if (sources.empty())
+      return empty_;
+
+    detail::tile_renderer renderer;
+    renderer.z2 = double(std::uint64_t(1) << z);
+    renderer.tx = x;
+    renderer.ty = y;
+    renderer.extent = options_.extent;
+    renderer.tolerance = z >= options_.max_zoom
+                         ? 0 : options_.tolerance / (options_.extent * renderer.z2);
+
+    auto result = std::make_shared<tile>();
+    result->reserve(sources.size());
+    for (const auto &source : sources) {
+      auto geom = source.geom.visit(renderer);
+      if (detail::count_points(geom) == 0)
+        continue;
+
+      const auto &f = features_[source.index];
+      result->emplace_back(std::move(geom), f.properties, f.id);
+    }
+    return result;
+  }
+
+  node *cache_find(std::uint64_t id) {
+    auto itr = cache_index_.find(id);
+    if (itr == cache_index_.end())
+      return nullptr;
+
+    cache_.splice(cache_.begin(), cache_, itr->second);
+    return &itr->second->second;
+  }
+
+  void cache_insert(std::uint64_t id, detail::tile_sources sources) {
+    auto itr = cache_index_.find(id);
+    if (itr != cache_index_.end()) {
+      cache_.erase(itr->second);
+      cache_index_.erase(itr);
+    }
+
+    cache_.emplace_front(id, node());
+    cache_.front().second.source = std::move(sources);
+    cache_index_[id] = cache_.begin();
+
+    while (cache_.size() > options_.cache_size) {
+      cache_index_.erase(cache_.back().first);
+      cache_.pop_back();
+    }
+  }
+
+  feature_collection features_;
+  tile_options options_;
+  std::shared_ptr<const tile> empty_;
+  std::unordered_map<std::uint64_t, node> index_;
+  cache_list cache_;
+  std::unordered_map<std::uint64_t, cache_list::iterator> cache_index_;
+};
+
+NS_GEOJSON_END
+NS_GAGO_END
+
+#endif //  GEOJSON_CPP_GAGO_GEOJSON_TILE_INDEX_H_
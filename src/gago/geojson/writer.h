@@ -0,0 +1,455 @@
+//
+// Copyright (c) 2018 ChuiZi (wuqinchun at gagogroup.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef GEOJSON_CPP_GAGO_GEOJSON_WRITER_H_
+#define GEOJSON_CPP_GAGO_GEOJSON_WRITER_H_
+
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <thread>
+#include <cstddef>
+#include <exception>
+#include <system_error>
+#include <mutex>
+#include <condition_variable>
+
+#include <unistd.h>
+
+#include <rapidjson/writer.h>
+#include <boost/variant.hpp>
+
+#include <gago/macros.h>
+#include <gago/parallel.h>
+#include <gago/geojson/geojson.h>
+
+NS_GAGO_BEGIN
+NS_GEOJSON_BEGIN
+
+// Minimal rapidjson output stream appending to a std::string, so finished
+// buffers can be moved around without copying.
+struct string_stream {
+  using Ch = char;
+
+  std::string &buffer;
+
+  explicit string_stream(std::string &buffer_) : buffer(buffer_) {}
+
+  void Put(char c) {
+    buffer.push_back(c);
+  }
+
+  void Flush() {}
+};
+
+using string_writer = rapidjson::Writer<string_stream>;
+
+namespace detail {
+
+inline const char *geometry_type_name(geometry_type type) {
+  static const char *names[] = {"Point", "MultiPoint", "LineString",
+                                "MultiLineString", "Polygon", "MultiPolygon"};
+  return names[int(type)];
+}
+
+template<typename Writer>
+void serialize_double(Writer &writer, double d) {
+  if (!writer.Double(d))
+    throw error("GeoJSON numbers must be finite");
+}
+
+template<typename Writer>
+void serialize_string(Writer &writer, const std::string &s) {
+  writer.String(s.data(), rapidjson::SizeType(s.size()));
+}
+
+template<typename Writer>
+void serialize_position(Writer &writer, const point &p) {
+  writer.StartArray();
+  serialize_double(writer, p.x());
+  serialize_double(writer, p.y());
+  writer.EndArray();
+}
+
+template<typename Writer, typename Range>
+void serialize_positions(Writer &writer, const Range &points) {
+  writer.StartArray();
+  for (const auto &p : points)
+    serialize_position(writer, p);
+  writer.EndArray();
+}
+
+template<typename Writer>
+void serialize_rings(Writer &writer, const polygon &p) {
+  writer.StartArray();
+  serialize_positions(writer, p.outer());
+  for (const auto &ring : p.inners())
+    serialize_positions(writer, ring);
+  writer.EndArray();
+}
+
+template<typename Writer>
+struct coordinates_serializer {
+  Writer &writer;
+
+  void operator()(const point &p) const {
+    serialize_position(writer, p);
+  }
+
+  void operator()(const multi_point &g) const {
+    serialize_positions(writer, g);
+  }
+
+  void operator()(const linestring &g) const {
+    serialize_positions(writer, g);
+  }
+
+  void operator()(const multi_linestring &g) const {
+    writer.StartArray();
+    for (const auto &line : g)
+      serialize_positions(writer, line);
+    writer.EndArray();
+  }
+
+  void operator()(const polygon &g) const {
+    serialize_rings(writer, g);
+  }
+
+  void operator()(const multi_polygon &g) const {
+    writer.StartArray();
+    for (const auto &p : g)
+      serialize_rings(writer, p);
+    writer.EndArray();
+  }
+};
+
+template<typename Writer>
+struct value_serializer : boost::static_visitor<void> {
+  Writer &writer;
+
+  explicit value_serializer(Writer &writer_) : writer(writer_) {}
+
+  void operator()(const null_value_t &) const {
+    writer.Null();
+  }
+
+  void operator()(bool b) const {
+    writer.Bool(b);
+  }
+
+  void operator()(std::uint64_t u) const {
+    writer.Uint64(u);
+  }
+
+  void operator()(std::int64_t i) const {
+    writer.Int64(i);
+  }
+
+  void operator()(double d) const {
+    serialize_double(writer, d);
+  }
+
+  void operator()(const std::string &s) const {
+    serialize_string(writer, s);
+  }
+
+  void operator()(const std::vector<value> &values) const {
+    writer.StartArray();
+    for (const auto &v : values)
+      boost::apply_visitor(*this, v);
+    writer.EndArray();
+  }
+
+  void operator()(const std::unordered_map<std::string, value> &map) const {
+    writer.StartObject();
+    for (const auto &member : map) {
+      serialize_string(writer, member.first);
+      boost::apply_visitor(*this, member.second);
+    }
+    writer.EndObject();
+  }
+};
+
+}  // namespace detail
+
+template<typename Writer>
+void serialize(Writer &writer, const geometry &g) {
+  writer.StartObject();
+  writer.Key("type");
+  writer.String(detail::geometry_type_name(type_of(g)));
+  writer.Key("coordinates");
+  visit(g, detail::coordinates_serializer<Writer>{writer});
+  writer.EndObject();
+}
+
+template<typename Writer>
+void serialize(Writer &writer, const value &v) {
+  boost::apply_visitor(detail::value_serializer<Writer>(writer), v);
+}
+
+template<typename Writer>
+void serialize(Writer &writer, const feature &f) {
+  writer.StartObject();
+  writer.Key("type");
+  writer.String("Feature");
+
+  if (f.id) {
+    writer.Key("id");
+    boost::apply_visitor(detail::value_serializer<Writer>(writer), *f.id);
+  }
+
+  if (f.bbox) {
+    writer.Key("bbox");
+    writer.StartArray();
+    detail::serialize_double(writer, f.bbox->min_corner().x());
+    detail::serialize_double(writer, f.bbox->min_corner().y());
+    detail::serialize_double(writer, f.bbox->max_corner().x());
+    detail::serialize_double(writer, f.bbox->max_corner().y());
+    writer.EndArray();
+  }
+
+  writer.Key("geometry");
+  serialize(writer, f.geometry);
+
+  writer.Key("properties");
+  writer.StartObject();
+  for (const auto &member : f.properties) {
+    detail::serialize_string(writer, member.first);
+    serialize(writer, member.second);
+  }
+  writer.EndObject();
+
+  writer.EndObject();
+}
+
+template<typename Writer>
+void serialize(Writer &writer, const feature_collection &features) {
+  writer.StartObject();
+  writer.Key("type");
+  writer.String("FeatureCollection");
+  writer.Key("features");
+  writer.StartArray();
+  for (const auto &f : features)
+    serialize(writer, f);
+  writer.EndArray();
+  writer.EndObject();
+}
+
+template<typename Writer, typename V>
+void serialize(Writer &writer, const gago::geometry::shared_value<V> &shared) {
+  serialize(writer, *shared);
+}
+
+template<typename Writer>
+void serialize(Writer &writer, const shared_feature_collection &features) {
+  writer.StartObject();
+  writer.Key("type");
+  writer.String("FeatureCollection");
+  writer.Key("features");
+  writer.StartArray();
+  for (const auto &f : features)
+    serialize(writer, *f);
+  writer.EndArray();
+  writer.EndObject();
+}
+
+template<typename Writer>
+void serialize(Writer &writer, const geojson &json) {
+  boost::apply_visitor([&writer](const auto &held) { serialize(writer, held); }, json);
+}
+
+template<typename T>
+std::string stringify(const T &t) {
+  std::string buffer;
+  string_stream stream(buffer);
+  string_writer writer(stream);
+  serialize(writer, t);
+  return buffer;
+}
+
+enum class output_format {
+  // A single FeatureCollection object.
+  FEATURE_COLLECTION = 0,
+  // One Feature per line.
+  NEWLINE_DELIMITED,
+  // RFC 8142 text sequence: each Feature prefixed by a record separator.
+  TEXT_SEQUENCE
+};
+
+struct write_options {
+  output_format format = output_format::FEATURE_COLLECTION;
+  // Formatting threads; zero means one per hardware thread.
+  std::size_t threads = 0;
+  // Features formatted by a thread at a time, and so written per call.
+  std::size_t chunk_size = 4096;
+  // Limits the decimals written per coordinate or number; 0 keeps all.
+  int max_decimal_places = 0;
+  // Write the features in space filling curve order, see spatial_order(),
+  // leaving the collection itself untouched.
+  bool spatial_order = false;
+  space_filling_curve curve = space_filling_curve::HILBERT;
+};
+
+namespace detail {
+
+inline void write_fully(int fd, const char *data, std::size_t size) {
+  while (size > 0) {
+    auto written = ::write(fd, data, size);
+    if (written < 0) {
+      if (errno == EINTR)
+        continue;
+      throw std::system_error(errno, std::generic_category(), "GeoJSON write failed");
+    }
+    data += written;
+    size -= std::size_t(written);
+  }
+}
+
+inline void format_chunk(const feature_collection &features,
+                         std::size_t begin,
+                         std::size_t end,
+                         const std::vector<std::size_t> &order,
+                         const write_options &options,
+                         std::string &buffer) {
+  string_stream stream(buffer);
+  string_writer writer(stream);
+  if (options.max_decimal_places > 0)
+    writer.SetMaxDecimalPlaces(options.max_decimal_places);
+
+  for (auto i = begin; i < end; i++) {
+    if (options.format == output_format::TEXT_SEQUENCE)
+      buffer.push_back('\x1e');
+    else if (options.format == output_format::FEATURE_COLLECTION && i != begin)
+      buffer.push_back(',');
+
+    writer.Reset(stream);
+    serialize(writer, features[order.empty() ? i : order[i]]);
+
+    if (options.format != output_format::FEATURE_COLLECTION)
+      buffer.push_back('\n');
+  }
+}
+
+}  // namespace detail
+
+// Writes a collection to a file descriptor. Chunks of `chunk_size`
+// features are formatted concurrently into per-thread buffers, while the
+// calling thread writes finished chunks in order with one write per chunk.
+// At most two chunks per thread are buffered at any time.
+inline void write(int fd, const feature_collection &features,
+                  const write_options &options = write_options{}) {
+  auto chunk_size = options.chunk_size == 0 ? 1 : options.chunk_size;
+  auto chunks = (features.size() + chunk_size - 1) / chunk_size;
+  auto threads = thread_count(options.threads);
+  if (threads > chunks)
+    threads = chunks;
+
+  std::vector<std::size_t> order;
+  if (options.spatial_order)
+    order = gago::geometry::spatial_order(features, options.curve, options.threads);
+
+  if (options.format == output_format::FEATURE_COLLECTION) {
+    const char prefix[] = "{\"type\":\"FeatureCollection\",\"features\":[";
+    detail::write_fully(fd, prefix, sizeof(prefix) - 1);
+  }
+
+  auto window = 2 * (threads == 0 ? 1 : threads);
+  std::vector<std::string> slots(window);
+  std::vector<bool> ready(window, false);
+  std::size_t claimed = 0, written = 0;
+  std::exception_ptr failure;
+  std::mutex mutex;
+  std::condition_variable changed;
+
+  auto worker = [&]() {
+    std::string buffer;
+    for (;;) {
+      std::size_t chunk;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&]() { return failure || claimed - written < window; });
+        if (failure || claimed >= chunks)
+          return;
+        chunk = claimed++;
+      }
+
+      try {
+        auto begin = chunk * chunk_size;
+        auto end = begin + chunk_size < features.size() ? begin + chunk_size : features.size();
+        detail::format_chunk(features, begin, end, order, options, buffer);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex);
+        failure = std::current_exception();
+        changed.notify_all();
+        return;
+      }
+
+      std::lock_guard<std::mutex> lock(mutex);
+      std::swap(slots[chunk % window], buffer);
+      ready[chunk % window] = true;
+      buffer.clear();
+      changed.notify_all();
+    }
+  };
+
+  std::vector<std::thread> workers;
+  for (std::size_t i = 0; i < threads; i++)
+    workers.emplace_back(worker);
+
+  std::string buffer;
+  try {
+    for (std::size_t chunk = 0; chunk < chunks; chunk++) {
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&]() { return failure || ready[chunk % window]; });
+        if (failure)
+          break;
+        std::swap(buffer, slots[chunk % window]);
+        ready[chunk % window] = false;
+        written++;
+        changed.notify_all();
+      }
+
+      if (chunk > 0 && options.format == output_format::FEATURE_COLLECTION)
+        detail::write_fully(fd, ",", 1);
+      detail::write_fully(fd, buffer.data(), buffer.size());
+      buffer.clear();
+    }
+  } catch (...) {
+    std::lock_guard<std::mutex> lock(mutex);
+    failure = std::current_exception();
+    changed.notify_all();
+  }
+
+  for (auto &w : workers)
+    w.join();
+  if (failure)
+    std::rethrow_exception(failure);
+
+  if (options.format == output_format::FEATURE_COLLECTION)
+    detail::write_fully(fd, "]}", 2);
+}
+
+NS_GEOJSON_END
+NS_GAGO_END
+
+#endif //  GEOJSON_CPP_GAGO_GEOJSON_WRITER_H_
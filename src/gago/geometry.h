@@ -29,8 +29,22 @@
 #include <gago/geometry/multi_linestring.h>
 #include <gago/geometry/polygon.h>
 #include <gago/geometry/multi_polygon.h>
+#include <gago/geometry/box.h>
 #include <gago/geometry/geometry.h>
+#include <gago/geometry/tagged_geometry.h>
 #include <gago/geometry/value.h>
 #include <gago/geometry/feature.h>
+#include <gago/geometry/simplify.h>
+#include <gago/geometry/polygon_join.h>
+#include <gago/geometry/kernels.h>
+#include <gago/geometry/projection.h>
+#include <gago/geometry/spatial_sort.h>
+#include <gago/geometry/feature_store.h>
+#include <gago/geometry/shared_feature.h>
+#include <gago/geometry/topology.h>
+#include <gago/geometry/validation.h>
+#include <gago/geometry/point_grid.h>
+#include <gago/geometry/rasterize.h>
+#include <gago/geometry/memory.h>
 
 #endif //  GEOJSON_CPP_GEOMETRY_GEOMETRY_H_
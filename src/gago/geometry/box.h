@@ -0,0 +1,82 @@
+//
+// Copyright (c) 2018 ChuiZi (wuqinchun at gagogroup.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef GEOJSON_CPP_GAGO_GEOMETRY_BOX_H_
+#define GEOJSON_CPP_GAGO_GEOMETRY_BOX_H_
+
+#include <limits>
+
+#include <boost/geometry/geometries/box.hpp>
+
+#include <gago/macros.h>
+#include <gago/geometry/point.h>
+
+NS_GAGO_BEGIN
+NS_GEOMETRY_BEGIN
+
+template<
+    typename T
+>
+using box = boost::geometry::model::box<point<T>>;
+
+// Running envelope of the points seen so far, cheap enough to update from
+// inside coordinate loops.
+template<
+    typename T
+>
+struct bounds {
+  T min_x = std::numeric_limits<T>::max();
+  T min_y = std::numeric_limits<T>::max();
+  T max_x = std::numeric_limits<T>::lowest();
+  T max_y = std::numeric_limits<T>::lowest();
+
+  bool empty() const {
+    return min_x > max_x;
+  }
+
+  void expand(T x, T y) {
+    if (x < min_x) min_x = x;
+    if (x > max_x) max_x = x;
+    if (y < min_y) min_y = y;
+    if (y > max_y) max_y = y;
+  }
+
+  void expand(const point<T> &p) {
+    expand(p.x(), p.y());
+  }
+
+  void expand(const bounds &other) {
+    if (other.empty())
+      return;
+    expand(other.min_x, other.min_y);
+    expand(other.max_x, other.max_y);
+  }
+
+  box<T> to_box() const {
+    return box<T>(point<T>(min_x, min_y), point<T>(max_x, max_y));
+  }
+};
+
+NS_GEOMETRY_END
+NS_GAGO_END
+
+#endif //  GEOJSON_CPP_GAGO_GEOMETRY_BOX_H_
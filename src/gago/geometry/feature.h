@@ -23,10 +23,12 @@
 #ifndef GEOJSON_CPP_GAGO_GEOMETRY_FEATURE_H_
 #define GEOJSON_CPP_GAGO_GEOMETRY_FEATURE_H_
 
+#include <vector>
 #include <unordered_map>
 #include <experimental/optional>
 
 #include <gago/macros.h>
+#include <gago/geometry/box.h>
 #include <gago/geometry/geometry.h>
 #include <gago/geometry/value.h>
 
@@ -38,10 +40,15 @@ using property_map = std::unordered_map<std::string, value>;
 template<class T>
 struct feature {
   using geometry_type = geometry<T>;
+  using box_type = box<T>;
 
   geometry_type geometry;
   property_map properties{};
   std::experimental::optional<identifier> id{};
+  // Envelope of the geometry; filled in by the converter when requested.
+  std::experimental::optional<box_type> bbox{};
+  // Envelope of every part of a multi-geometry, in part order.
+  std::vector<box_type> part_bboxes{};
 
   feature(geometry_type geometry_,
           property_map properties_ = property_map {},
@@ -0,0 +1,299 @@
+//
+// Copyright (c) 2018 ChuiZi (wuqinchun at gagogroup.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef GEOJSON_CPP_GAGO_GEOMETRY_FEATURE_STORE_H_
+#define GEOJSON_CPP_GAGO_GEOMETRY_FEATURE_STORE_H_
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+#include <iterator>
+#include <stdexcept>
+#include <functional>
+#include <unordered_map>
+#include <experimental/optional>
+
+#include <boost/variant.hpp>
+#include <boost/geometry/index/rtree.hpp>
+
+#include <gago/macros.h>
+#include <gago/geometry/box.h>
+#include <gago/geometry/geometry.h>
+#include <gago/geometry/value.h>
+#include <gago/geometry/feature.h>
+
+NS_GAGO_BEGIN
+NS_GEOMETRY_BEGIN
+
+// Hashes an identifier by its alternative and value, consistent with the
+// variant's own equality: 1, -1, 1.0 and "1" are four different ids.
+struct identifier_hash {
+  struct visitor : boost::static_visitor<std::size_t> {
+    std::size_t operator()(std::uint64_t u) const {
+      return std::hash<std::uint64_t>()(u);
+    }
+
+    std::size_t operator()(std::int64_t i) const {
+      return std::hash<std::int64_t>()(i);
+    }
+
+    std::size_t operator()(double d) const {
+      return std::hash<double>()(d);
+    }
+
+    std::size_t operator()(const std::string &s) const {
+      return std::hash<std::string>()(s);
+    }
+  };
+
+  std::size_t operator()(const identifier &id) const {
+    return boost::apply_visitor(visitor(), id) * 31 + std::size_t(id.which());
+  }
+};
+
+// Spatial index policy that keeps no index.
+template<typename T>
+struct no_index {
+  void insert(std::size_t, const box<T> &) {}
+  void remove(std::size_t, const box<T> &) {}
+  void clear() {}
+};
+
+// Spatial index policy keeping an R*-tree of the slots' envelopes,
+// updated one feature at a time.
+template<typename T>
+class rtree_index {
+ public:
+  using value_type = std::pair<box<T>, std::size_t>;
+
+  void insert(std::size_t slot, const box<T> &b) {
+    tree_.insert(value_type(b, slot));
+  }
+
+  void remove(std::size_t slot, const box<T> &b) {
+    tree_.remove(value_type(b, slot));
+  }
+
+  void clear() {
+    tree_.clear();
+  }
+
+  // Slots whose envelopes intersect `b`, in no particular order.
+  std::vector<std::size_t> query(const box<T> &b) const {
+    std::vector<value_type> hits;
+    tree_.query(boost::geometry::index::intersects(b), std::back_inserter(hits));
+
+    std::vector<std::size_t> slots;
+    slots.reserve(hits.size());
+    for (const auto &hit : hits)
+      slots.push_back(hit.second);
+    return slots;
+  }
+
+  std::size_t size() const {
+    return tree_.size();
+  }
+
+ private:
+  boost::geometry::index::rtree<value_type, boost::geometry::index::rstar<16>> tree_;
+};
+
+// Features keyed by identifier. Each feature lives in a slot that stays put
+// until the feature is erased, so slot numbers can be handed to the spatial
+// index; erased slots are reused by later inserts. Lookup, upsert and erase
+// by id are O(1) on average, plus the index update.
+//
+// An Index policy provides insert(slot, box), remove(slot, box) and
+// clear(); it is told about every feature with a non-empty envelope, which
+// is the feature's cached bbox or else computed from its geometry.
+template<
+    typename T,
+    typename Index = no_index<T>
+>
+class feature_store {
+ public:
+  using feature_type = feature<T>;
+  using index_type = Index;
+
+  static constexpr std::size_t npos = std::size_t(-1);
+
+  feature_store() = default;
+
+  explicit feature_store(Index index) : index_(std::move(index)) {}
+
+  template<template<typename...> class Container>
+  explicit feature_store(feature_collection<T, Container> features, Index index = Index()) :
+      index_(std::move(index)) {
+    reserve(features.size());
+    for (auto &f : features)
+      upsert(std::move(f));
+  }
+
+  std::size_t size() const {
+    return ids_.size();
+  }
+
+  bool empty() const {
+    return ids_.empty();
+  }
+
+  void reserve(std::size_t count) {
+    slots_.reserve(count);
+    ids_.reserve(count);
+  }
+
+  // Slot of the feature with this id, or npos.
+  std::size_t slot_of(const identifier &id) const {
+    auto it = ids_.find(id);
+    return it == ids_.end() ? npos : it->second;
+  }
+
+  const feature_type *find(const identifier &id) const {
+    auto slot = slot_of(id);
+    return slot == npos ? nullptr : &*slots_[slot].feature;
+  }
+
+  bool contains(const identifier &id) const {
+    return ids_.count(id) != 0;
+  }
+
+  // The feature in a live slot, e.g. one returned by the index.
+  const feature_type &at(std::size_t slot) const {
+    if (slot >= slots_.size() || !slots_[slot].feature)
+      throw std::out_of_range("feature_store slot is empty");
+    return *slots_[slot].feature;
+  }
+
+  // Inserts a feature or replaces the one with the same id, keeping its
+  // slot. Returns the slot. Features must carry an id.
+  std::size_t upsert(feature_type f) {
+    if (!f.id)
+      throw std::invalid_argument("feature_store requires features with an id");
+
+    auto it = ids_.find(*f.id);
+    std::size_t slot;
+    if (it != ids_.end()) {
+      slot = it->second;
+      unindex(slot);
+      slots_[slot].feature = std::move(f);
+    } else {
+      if (free_.empty()) {
+        slot = slots_.size();
+        slots_.emplace_back();
+      } else {
+        slot = free_.back();
+        free_.pop_back();
+      }
+      slots_[slot].feature = std::move(f);
+      ids_.emplace(*slots_[slot].feature->id, slot);
+    }
+
+    reindex(slot);
+    return slot;
+  }
+
+  // Removes the feature with this id; returns whether there was one.
+  bool erase(const identifier &id) {
+    auto it = ids_.find(id);
+    if (it == ids_.end())
+      return false;
+
+    auto slot = it->second;
+    ids_.erase(it);
+    unindex(slot);
+    slots_[slot].feature = std::experimental::nullopt;
+    free_.push_back(slot);
+    return true;
+  }
+
+  void clear() {
+    slots_.clear();
+    free_.clear();
+    ids_.clear();
+    index_.clear();
+  }
+
+  // Calls f(slot, feature) for every feature, in slot order.
+  template<typename F>
+  void for_each(F &&f) const {
+    for (std::size_t slot = 0; slot < slots_.size(); slot++) {
+      if (slots_[slot].feature)
+        f(slot, *slots_[slot].feature);
+    }
+  }
+
+  feature_collection<T> to_collection() const {
+    feature_collection<T> features;
+    features.reserve(size());
+    for_each([&features](std::size_t, const feature_type &f) { features.push_back(f); });
+    return features;
+  }
+
+  const Index &index() const {
+    return index_;
+  }
+
+ private:
+  struct slot_type {
+    std::experimental::optional<feature_type> feature;
+    // Envelope the slot is registered under in the index, if any.
+    std::experimental::optional<box<T>> indexed;
+  };
+
+  void unindex(std::size_t slot) {
+    auto &s = slots_[slot];
+    if (s.indexed) {
+      index_.remove(slot, *s.indexed);
+      s.indexed = std::experimental::nullopt;
+    }
+  }
+
+  void reindex(std::size_t slot) {
+    auto &s = slots_[slot];
+    const auto &f = *s.feature;
+    if (f.bbox) {
+      s.indexed = *f.bbox;
+    } else {
+      bounds<T> b;
+      gago::geometry::for_each_point(f.geometry, [&b](const point<T> &p) { b.expand(p); });
+      if (b.empty())
+        return;
+      s.indexed = b.to_box();
+    }
+    index_.insert(slot, *s.indexed);
+  }
+
+  std::vector<slot_type> slots_;
+  std::vector<std::size_t> free_;
+  std::unordered_map<identifier, std::size_t, identifier_hash> ids_;
+  Index index_;
+};
+
+template<typename T, typename Index>
+constexpr std::size_t feature_store<T, Index>::npos;
+
+NS_GEOMETRY_END
+NS_GAGO_END
+
+#endif //  GEOJSON_CPP_GAGO_GEOMETRY_FEATURE_STORE_H_
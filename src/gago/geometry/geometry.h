@@ -23,7 +23,13 @@
 #ifndef GEOJSON_CPP_GAGO_GEOMETRY_GEOMETRY_H_
 #define GEOJSON_CPP_GAGO_GEOMETRY_GEOMETRY_H_
 
+#include <cstdint>
+#include <utility>
+#include <type_traits>
+
 #include <boost/variant.hpp>
+#include <boost/geometry/core/tags.hpp>
+#include <boost/geometry/core/tag.hpp>
 
 #include <gago/macros.h>
 #include <gago/geometry/point.h>
@@ -45,6 +51,170 @@ using geometry= boost::variant<point<T>,
                                      multi_polygon<T>
 >;
 
+// Matches the order of the alternatives in `geometry`, so a tag can be
+// compared with `geometry::which()`.
+enum class geometry_type : std::uint8_t {
+  POINT = 0,
+  MULTIPOINT,
+  LINESTRING,
+  MULTILINESTRING,
+  POLYGON,
+  MULTIPOLYGON
+};
+
+template<geometry_type Type, typename T>
+struct geometry_of;
+
+template<typename T>
+struct geometry_of<geometry_type::POINT, T> { using type = point<T>; };
+template<typename T>
+struct geometry_of<geometry_type::MULTIPOINT, T> { using type = multi_point<T>; };
+template<typename T>
+struct geometry_of<geometry_type::LINESTRING, T> { using type = linestring<T>; };
+template<typename T>
+struct geometry_of<geometry_type::MULTILINESTRING, T> { using type = multi_linestring<T>; };
+template<typename T>
+struct geometry_of<geometry_type::POLYGON, T> { using type = polygon<T>; };
+template<typename T>
+struct geometry_of<geometry_type::MULTIPOLYGON, T> { using type = multi_polygon<T>; };
+
+template<typename Geometry>
+struct geometry_type_of;
+
+template<typename T>
+struct geometry_type_of<point<T>>
+    : std::integral_constant<geometry_type, geometry_type::POINT> {};
+template<typename T>
+struct geometry_type_of<multi_point<T>>
+    : std::integral_constant<geometry_type, geometry_type::MULTIPOINT> {};
+template<typename T>
+struct geometry_type_of<linestring<T>>
+    : std::integral_constant<geometry_type, geometry_type::LINESTRING> {};
+template<typename T>
+struct geometry_type_of<multi_linestring<T>>
+    : std::integral_constant<geometry_type, geometry_type::MULTILINESTRING> {};
+template<typename T>
+struct geometry_type_of<polygon<T>>
+    : std::integral_constant<geometry_type, geometry_type::POLYGON> {};
+template<typename T>
+struct geometry_type_of<multi_polygon<T>>
+    : std::integral_constant<geometry_type, geometry_type::MULTIPOLYGON> {};
+
+template<typename T>
+geometry_type type_of(const geometry<T> &g) {
+  return geometry_type(g.which());
+}
+
+namespace detail {
+
+template<typename F, typename Result>
+struct visitor_adapter : boost::static_visitor<Result> {
+  F &f;
+
+  explicit visitor_adapter(F &f_) : f(f_) {}
+
+  template<typename Geometry>
+  Result operator()(Geometry &g) const {
+    return f(g);
+  }
+};
+
+}  // namespace detail
+
+// Calls `f` with the geometry held by `g`; `f` is typically a generic
+// lambda, or a functor overloaded on the six geometry types.
+template<typename T, typename F>
+auto visit(const geometry<T> &g, F &&f) -> decltype(f(std::declval<const point<T> &>())) {
+  using result = decltype(f(std::declval<const point<T> &>()));
+  detail::visitor_adapter<F, result> adapter(f);
+  return boost::apply_visitor(adapter, g);
+}
+
+template<typename T, typename F>
+auto visit(geometry<T> &g, F &&f) -> decltype(f(std::declval<point<T> &>())) {
+  using result = decltype(f(std::declval<point<T> &>()));
+  detail::visitor_adapter<F, result> adapter(f);
+  return boost::apply_visitor(adapter, g);
+}
+
+namespace detail {
+
+template<typename Geometry, typename F>
+void for_each_point(Geometry &g, F &f, boost::geometry::point_tag) {
+  f(g);
+}
+
+template<typename Geometry, typename F>
+void for_each_point(Geometry &g, F &f, boost::geometry::multi_point_tag) {
+  for (auto &p : g)
+    f(p);
+}
+
+template<typename Geometry, typename F>
+void for_each_point(Geometry &g, F &f, boost::geometry::linestring_tag) {
+  for (auto &p : g)
+    f(p);
+}
+
+template<typename Geometry, typename F>
+void for_each_point(Geometry &g, F &f, boost::geometry::ring_tag) {
+  for (auto &p : g)
+    f(p);
+}
+
+template<typename Geometry, typename F>
+void for_each_point(Geometry &g, F &f, boost::geometry::multi_linestring_tag) {
+  for (auto &line : g)
+    for (auto &p : line)
+      f(p);
+}
+
+template<typename Geometry, typename F>
+void for_each_point(Geometry &g, F &f, boost::geometry::polygon_tag) {
+  for (auto &p : g.outer())
+    f(p);
+  for (auto &ring : g.inners())
+    for (auto &p : ring)
+      f(p);
+}
+
+template<typename Geometry, typename F>
+void for_each_point(Geometry &g, F &f, boost::geometry::multi_polygon_tag) {
+  for (auto &polygon : g)
+    for_each_point(polygon, f, boost::geometry::polygon_tag());
+}
+
+template<typename F>
+struct point_visitor {
+  F &f;
+
+  template<typename Geometry>
+  void operator()(Geometry &g) const {
+    using tag = typename boost::geometry::tag<typename std::remove_const<Geometry>::type>::type;
+    for_each_point(g, f, tag());
+  }
+};
+
+}  // namespace detail
+
+// Calls `f` on every point of a geometry, ring, or of any geometry held by
+// a `geometry` variant. The type is resolved once, so each kind of
+// geometry gets its own tight loop.
+template<typename Geometry, typename F>
+void for_each_point(Geometry &g, F &&f) {
+  detail::point_visitor<F> visitor{f};
+  visitor(g);
+}
+
+template<typename T, typename F>
+void for_each_point(const geometry<T> &g, F &&f) {
+  visit(g, detail::point_visitor<F>{f});
+}
+
+template<typename T, typename F>
+void for_each_point(geometry<T> &g, F &&f) {
+  visit(g, detail::point_visitor<F>{f});
+}
 
 NS_GEOMETRY_END
 NS_GAGO_END
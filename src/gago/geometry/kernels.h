@@ -0,0 +1,504 @@
+//
+// Copyright (c) 2018 ChuiZi (wuqinchun at gagogroup.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef GEOJSON_CPP_GAGO_GEOMETRY_KERNELS_H_
+#define GEOJSON_CPP_GAGO_GEOMETRY_KERNELS_H_
+
+#include <cmath>
+#include <vector>
+#include <cstddef>
+
+#include <boost/geometry/core/tags.hpp>
+#include <boost/geometry/core/tag.hpp>
+
+#include <gago/macros.h>
+#include <gago/parallel.h>
+#include <gago/geometry/box.h>
+#include <gago/geometry/feature.h>
+#include <gago/geometry/geometry.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GAGO_KERNELS_X86 1
+#include <immintrin.h>
+#endif
+
+NS_GAGO_BEGIN
+NS_GEOMETRY_BEGIN
+
+// Reductions over the coordinates of double geometries, vectorized with
+// SSE2 or AVX2 when the CPU supports them. Rings and lines are read
+// straight from their contiguous storage as interleaved x, y pairs.
+namespace kernels {
+
+enum class simd_level {
+  SCALAR = 0,
+  SSE2,
+  AVX2
+};
+
+namespace detail {
+
+static_assert(sizeof(point<double>) == 2 * sizeof(double),
+              "kernels read points as interleaved x, y pairs");
+
+// Every kernel takes `n` points at `xy`; the pairwise kernels look at the
+// n - 1 segments between consecutive points.
+struct kernel_set {
+  void (*envelope)(const double *xy, std::size_t n, bounds<double> &result);
+  // Sum of x[i] * y[i + 1] - x[i + 1] * y[i].
+  double (*cross_sum)(const double *xy, std::size_t n);
+  double (*length)(const double *xy, std::size_t n);
+  // Sums of the cross terms c[i], of (x[i] + x[i + 1]) * c[i] and of
+  // (y[i] + y[i + 1]) * c[i], used for polygon centroids.
+  void (*centroid_sums)(const double *xy, std::size_t n, double *sums);
+};
+
+inline void envelope_scalar(const double *xy, std::size_t n, bounds<double> &result) {
+  for (std::size_t i = 0; i < n; i++)
+    result.expand(xy[2 * i], xy[2 * i + 1]);
+}
+
+inline double cross_sum_scalar(const double *xy, std::size_t n) {
+  double sum = 0;
+  for (std::size_t i = 0; i + 1 < n; i++)
+    sum += xy[2 * i] * xy[2 * i + 3] - xy[2 * i + 2] * xy[2 * i + 1];
+  return sum;
+}
+
+inline double length_scalar(const double *xy, std::size_t n) {
+  double sum = 0;
+  for (std::size_t i = 0; i + 1 < n; i++) {
+    auto dx = xy[2 * i + 2] - xy[2 * i], dy = xy[2 * i + 3] - xy[2 * i + 1];
+    sum += std::sqrt(dx * dx + dy * dy);
+  }
+  return sum;
+}
+
+inline void centroid_sums_scalar(const double *xy, std::size_t n, double *sums) {
+  for (std::size_t i = 0; i + 1 < n; i++) {
+    auto c = xy[2 * i] * xy[2 * i + 3] - xy[2 * i + 2] * xy[2 * i + 1];
+    sums[0] += c;
+    sums[1] += (xy[2 * i] + xy[2 * i + 2]) * c;
+    sums[2] += (xy[2 * i + 1] + xy[2 * i + 3]) * c;
+  }
+}
+
+#ifdef GAGO_KERNELS_X86
+
+__attribute__((target("sse2")))
+inline void envelope_sse2(const double *xy, std::size_t n, bounds<double> &result) {
+  if (n == 0)
+    return;
+
+  auto lo = _mm_loadu_pd(xy), hi = lo;
+  for (std::size_t i = 1; i < n; i++) {
+    auto p = _mm_loadu_pd(xy + 2 * i);
+    lo = _mm_min_pd(lo, p);
+    hi = _mm_max_pd(hi, p);
+  }
+
+  double l[2], h[2];
+  _mm_storeu_pd(l, lo);
+  _mm_storeu_pd(h, hi);
+  result.expand(l[0], l[1]);
+  result.expand(h[0], h[1]);
+}
+
+__attribute__((target("sse2")))
+inline double cross_sum_sse2(const double *xy, std::size_t n) {
+  auto acc = _mm_setzero_pd();
+  for (std::size_t i = 0; i + 1 < n; i++) {
+    auto a = _mm_loadu_pd(xy + 2 * i), b = _mm_loadu_pd(xy + 2 * i + 2);
+    acc = _mm_add_pd(acc, _mm_mul_pd(a, _mm_shuffle_pd(b, b, 1)));
+  }
+
+  double r[2];
+  _mm_storeu_pd(r, acc);
+  return r[0] - r[1];
+}
+
+__attribute__((target("sse2")))
+inline double length_sse2(const double *xy, std::size_t n) {
+  auto acc = _mm_setzero_pd();
+  std::size_t i = 0;
+  for (; i + 2 < n; i += 2) {
+    auto a = _mm_loadu_pd(xy + 2 * i);
+    auto b = _mm_loadu_pd(xy + 2 * i + 2);
+    auto c = _mm_loadu_pd(xy + 2 * i + 4);
+    auto d0 = _mm_sub_pd(b, a), d1 = _mm_sub_pd(c, b);
+    d0 = _mm_mul_pd(d0, d0);
+    d1 = _mm_mul_pd(d1, d1);
+    auto sq = _mm_add_pd(_mm_unpacklo_pd(d0, d1), _mm_unpackhi_pd(d0, d1));
+    acc = _mm_add_pd(acc, _mm_sqrt_pd(sq));
+  }
+
+  double r[2];
+  _mm_storeu_pd(r, acc);
+  return r[0] + r[1] + length_scalar(xy + 2 * i, n - i);
+}
+
+__attribute__((target("sse2")))
+inline void centroid_sums_sse2(const double *xy, std::size_t n, double *sums) {
+  auto acc_c = _mm_setzero_pd(), acc_s = _mm_setzero_pd();
+  for (std::size_t i = 0; i + 1 < n; i++) {
+    auto a = _mm_loadu_pd(xy + 2 * i), b = _mm_loadu_pd(xy + 2 * i + 2);
+    auto prod = _mm_mul_pd(a, _mm_shuffle_pd(b, b, 1));
+    auto c = _mm_sub_pd(prod, _mm_shuffle_pd(prod, prod, 1));
+    acc_c = _mm_add_pd(acc_c, c);
+    acc_s = _mm_add_pd(acc_s, _mm_mul_pd(_mm_add_pd(a, b), _mm_unpacklo_pd(c, c)));
+  }
+
+  double c[2], s[2];
+  _mm_storeu_pd(c, acc_c);
+  _mm_storeu_pd(s, acc_s);
+  sums[0] += c[0];
+  sums[1] += s[0];
+  sums[2] += s[1];
+}
+
+__attribute__((target("avx2")))
+inline void envelope_avx2(const double *xy, std::size_t n, bounds<double> &result) {
+  if (n < 2) {
+    envelope_scalar(xy, n, result);
+    return;
+  }
+
+  auto lo = _mm256_loadu_pd(xy), hi = lo;
+  std::size_t i = 2;
+  for (; i + 1 < n; i += 2) {
+    auto p = _mm256_loadu_pd(xy + 2 * i);
+    lo = _mm256_min_pd(lo, p);
+    hi = _mm256_max_pd(hi, p);
+  }
+
+  auto l = _mm_min_pd(_mm256_castpd256_pd128(lo), _mm256_extractf128_pd(lo, 1));
+  auto h = _mm_max_pd(_mm256_castpd256_pd128(hi), _mm256_extractf128_pd(hi, 1));
+  double lv[2], hv[2];
+  _mm_storeu_pd(lv, l);
+  _mm_storeu_pd(hv, h);
+  result.expand(lv[0], lv[1]);
+  result.expand(hv[0], hv[1]);
+  envelope_scalar(xy + 2 * i, n - i, result);
+}
+
+__attribute__((target("avx2")))
+inline double cross_sum_avx2(const double *xy, std::size_t n) {
+  auto acc = _mm256_setzero_pd();
+  std::size_t i = 0;
+  for (; i + 2 < n; i += 2) {
+    auto a = _mm256_loadu_pd(xy + 2 * i), b = _mm256_loadu_pd(xy + 2 * i + 2);
+    acc = _mm256_add_pd(acc, _mm256_mul_pd(a, _mm256_permute_pd(b, 0x5)));
+  }
+
+  double r[4];
+  _mm256_storeu_pd(r, acc);
+  return (r[0] + r[2]) - (r[1] + r[3]) + cross_sum_scalar(xy + 2 * i, n - i);
+}
+
+__attribute__((target("avx2")))
+inline double length_avx2(const double *xy, std::size_t n) {
+  auto acc = _mm256_setzero_pd();
+  std::size_t i = 0;
+  for (; i + 2 < n; i += 2) {
+    auto a = _mm256_loadu_pd(xy + 2 * i), b = _mm256_loadu_pd(xy + 2 * i + 2);
+    auto d = _mm256_sub_pd(b, a);
+    d = _mm256_mul_pd(d, d);
+    acc = _mm256_add_pd(acc, _mm256_sqrt_pd(_mm256_hadd_pd(d, d)));
+  }
+
+  // Each segment length sits in two lanes after the horizontal add.
+  double r[4];
+  _mm256_storeu_pd(r, acc);
+  return r[0] + r[2] + length_scalar(xy + 2 * i, n - i);
+}
+
+__attribute__((target("avx2")))
+inline void centroid_sums_avx2(const double *xy, std::size_t n, double *sums) {
+  auto acc_c = _mm256_setzero_pd(), acc_s = _mm256_setzero_pd();
+  std::size_t i = 0;
+  for (; i + 2 < n; i += 2) {
+    auto a = _mm256_loadu_pd(xy + 2 * i), b = _mm256_loadu_pd(xy + 2 * i + 2);
+    auto prod = _mm256_mul_pd(a, _mm256_permute_pd(b, 0x5));
+    auto c = _mm256_sub_pd(prod, _mm256_permute_pd(prod, 0x5));
+    acc_c = _mm256_add_pd(acc_c, c);
+    acc_s = _mm256_add_pd(acc_s, _mm256_mul_pd(_mm256_add_pd(a, b), _mm256_movedup_pd(c)));
+  }
+
+  double c[4], s[4];
+  _mm256_storeu_pd(c, acc_c);
+  _mm256_storeu_pd(s, acc_s);
+  sums[0] += c[0] + c[2];
+  sums[1] += s[0] + s[2];
+  sums[2] += s[1] + s[3];
+  centroid_sums_scalar(xy + 2 * i, n - i, sums);
+}
+
+#endif  // GAGO_KERNELS_X86
+
+inline simd_level detect_simd_level() {
+#ifdef GAGO_KERNELS_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    return simd_level::AVX2;
+  if (__builtin_cpu_supports("sse2"))
+    return simd_level::SSE2;
+#endif
+  return simd_level::SCALAR;
+}
+
+inline const kernel_set &kernels_for(simd_level level) {
+  static const kernel_set scalar{envelope_scalar, cross_sum_scalar,
+                                 length_scalar, centroid_sums_scalar};
+#ifdef GAGO_KERNELS_X86
+  static const kernel_set sse2{envelope_sse2, cross_sum_sse2,
+                               length_sse2, centroid_sums_sse2};
+  static const kernel_set avx2{envelope_avx2, cross_sum_avx2,
+                               length_avx2, centroid_sums_avx2};
+  if (level == simd_level::AVX2)
+    return avx2;
+  if (level == simd_level::SSE2)
+    return sse2;
+#endif
+  return scalar;
+}
+
+inline const kernel_set &selected_kernels() {
+  static const kernel_set &selected = kernels_for(detect_simd_level());
+  return selected;
+}
+
+template<typename Range>
+const double *coordinates(const Range &range) {
+  return reinterpret_cast<const double *>(range.data());
+}
+
+// Calls f(xy, n) for every ring or line of a geometry, and once per point.
+template<typename Geometry, typename F>
+void for_each_range(const Geometry &g, F &f, boost::geometry::point_tag) {
+  f(reinterpret_cast<const double *>(&g), std::size_t(1));
+}
+
+template<typename Geometry, typename F>
+void for_each_range(const Geometry &g, F &f, boost::geometry::multi_point_tag) {
+  f(coordinates(g), g.size());
+}
+
+template<typename Geometry, typename F>
+void for_each_range(const Geometry &g, F &f, boost::geometry::linestring_tag) {
+  f(coordinates(g), g.size());
+}
+
+template<typename Geometry, typename F>
+void for_each_range(const Geometry &g, F &f, boost::geometry::multi_linestring_tag) {
+  for (const auto &line : g)
+    f(coordinates(line), line.size());
+}
+
+template<typename Geometry, typename F>
+void for_each_range(const Geometry &g, F &f, boost::geometry::polygon_tag) {
+  f(coordinates(g.outer()), g.outer().size());
+  for (const auto &ring : g.inners())
+    f(coordinates(ring), ring.size());
+}
+
+template<typename Geometry, typename F>
+void for_each_range(const Geometry &g, F &f, boost::geometry::multi_polygon_tag) {
+  for (const auto &p : g)
+    for_each_range(p, f, boost::geometry::polygon_tag());
+}
+
+template<typename F>
+void for_each_range(const geometry<double> &g, F &&f) {
+  visit(g, [&f](const auto &held) {
+    using tag = typename boost::geometry::tag<typename std::decay<decltype(held)>::type>::type;
+    for_each_range(held, f, tag());
+  });
+}
+
+template<typename Geometry>
+bool is_areal(const Geometry &g) {
+  auto type = type_of(g);
+  return type == geometry_type::POLYGON || type == geometry_type::MULTIPOLYGON;
+}
+
+template<typename Geometry>
+bool is_linear(const Geometry &g) {
+  auto type = type_of(g);
+  return type == geometry_type::LINESTRING || type == geometry_type::MULTILINESTRING;
+}
+
+// Rings are expected to be closed; an open ring gets its closing segment.
+inline double ring_cross_sum(const kernel_set &k, const double *xy, std::size_t n) {
+  if (n < 2)
+    return 0;
+  auto sum = k.cross_sum(xy, n);
+  auto last = 2 * (n - 1);
+  if (xy[0] != xy[last] || xy[1] != xy[last + 1])
+    sum += xy[last] * xy[1] - xy[0] * xy[last + 1];
+  return sum;
+}
+
+inline double haversine(double lon1, double lat1, double lon2, double lat2) {
+  const double to_radians = M_PI / 180;
+  auto sin_lat = std::sin((lat2 - lat1) * to_radians / 2);
+  auto sin_lon = std::sin((lon2 - lon1) * to_radians / 2);
+  auto h = sin_lat * sin_lat
+      + std::cos(lat1 * to_radians) * std::cos(lat2 * to_radians) * sin_lon * sin_lon;
+  return 2 * std::asin(std::sqrt(h < 1 ? h : 1));
+}
+
+}  // namespace detail
+
+inline simd_level best_simd_level() {
+  static const simd_level level = detail::detect_simd_level();
+  return level;
+}
+
+inline bounds<double> envelope(const geometry<double> &g) {
+  const auto &k = detail::selected_kernels();
+  bounds<double> result;
+  detail::for_each_range(g, [&](const double *xy, std::size_t n) {
+    k.envelope(xy, n, result);
+  });
+  return result;
+}
+
+// Envelope of a polygon, which is that of its outer ring.
+inline bounds<double> envelope(const polygon<double> &p) {
+  bounds<double> result;
+  detail::selected_kernels().envelope(detail::coordinates(p.outer()), p.outer().size(), result);
+  return result;
+}
+
+// Area with the sign convention of boost::geometry::area for the library's
+// clockwise polygons; zero for points and lines.
+inline double area(const geometry<double> &g) {
+  if (!detail::is_areal(g))
+    return 0;
+
+  const auto &k = detail::selected_kernels();
+  double sum = 0;
+  detail::for_each_range(g, [&](const double *xy, std::size_t n) {
+    sum += detail::ring_cross_sum(k, xy, n);
+  });
+  return -sum / 2;
+}
+
+// Planar length of lines; zero for other geometries, as in Boost.
+inline double length(const geometry<double> &g) {
+  if (!detail::is_linear(g))
+    return 0;
+
+  const auto &k = detail::selected_kernels();
+  double sum = 0;
+  detail::for_each_range(g, [&](const double *xy, std::size_t n) {
+    sum += k.length(xy, n);
+  });
+  return sum;
+}
+
+// Great circle length of lines with longitude, latitude coordinates in
+// degrees. The trigonometry keeps this kernel scalar.
+inline double haversine_length(const geometry<double> &g, double radius = 6371008.8) {
+  if (!detail::is_linear(g))
+    return 0;
+
+  double sum = 0;
+  detail::for_each_range(g, [&](const double *xy, std::size_t n) {
+    for (std::size_t i = 0; i + 1 < n; i++)
+      sum += detail::haversine(xy[2 * i], xy[2 * i + 1], xy[2 * i + 2], xy[2 * i + 3]);
+  });
+  return sum * radius;
+}
+
+// Area weighted centroid of polygons, length weighted centroid of lines
+// and mean of points. Degenerate geometries fall back to the next kind.
+inline point<double> centroid(const geometry<double> &g) {
+  const auto &k = detail::selected_kernels();
+
+  if (detail::is_areal(g)) {
+    double sums[3] = {0, 0, 0};
+    detail::for_each_range(g, [&](const double *xy, std::size_t n) {
+      k.centroid_sums(xy, n, sums);
+    });
+    if (sums[0] != 0)
+      return point<double>(sums[1] / (3 * sums[0]), sums[2] / (3 * sums[0]));
+  }
+
+  if (detail::is_areal(g) || detail::is_linear(g)) {
+    double total = 0, x = 0, y = 0;
+    detail::for_each_range(g, [&](const double *xy, std::size_t n) {
+      for (std::size_t i = 0; i + 1 < n; i++) {
+        auto l = detail::length_scalar(xy + 2 * i, 2);
+        total += l;
+        x += (xy[2 * i] + xy[2 * i + 2]) / 2 * l;
+        y += (xy[2 * i + 1] + xy[2 * i + 3]) / 2 * l;
+      }
+    });
+    if (total != 0)
+      return point<double>(x / total, y / total);
+  }
+
+  double x = 0, y = 0;
+  std::size_t count = 0;
+  for_each_point(g, [&](const point<double> &p) {
+    x += p.x();
+    y += p.y();
+    count++;
+  });
+  return count == 0 ? point<double>(0, 0) : point<double>(x / count, y / count);
+}
+
+// Batch versions over a collection, one result per feature, spread over
+// `threads` threads (zero means one per hardware thread).
+template<typename F>
+auto map_features(const feature_collection<double> &features, std::size_t threads, F f)
+-> std::vector<decltype(f(features.front().geometry))> {
+  std::vector<decltype(f(features.front().geometry))> result(features.size());
+  parallel_for(features.size(), threads, [&](std::size_t begin, std::size_t end) {
+    for (auto i = begin; i < end; i++)
+      result[i] = f(features[i].geometry);
+  });
+  return result;
+}
+
+inline std::vector<bounds<double>> envelopes(const feature_collection<double> &features,
+                                             std::size_t threads = 0) {
+  return map_features(features, threads, [](const geometry<double> &g) { return envelope(g); });
+}
+
+inline std::vector<double> areas(const feature_collection<double> &features,
+                                 std::size_t threads = 0) {
+  return map_features(features, threads, [](const geometry<double> &g) { return area(g); });
+}
+
+inline std::vector<double> lengths(const feature_collection<double> &features,
+                                   std::size_t threads = 0) {
+  return map_features(features, threads, [](const geometry<double> &g) { return length(g); });
+}
+
+}  // namespace kernels
+
+NS_GEOMETRY_END
+NS_GAGO_END
+
+#endif //  GEOJSON_CPP_GAGO_GEOMETRY_KERNELS_H_
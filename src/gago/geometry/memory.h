@@ -0,0 +1,293 @@
+//
+// Copyright (c) 2018 ChuiZi (wuqinchun at gagogroup.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef GEOJSON_CPP_GAGO_GEOMETRY_MEMORY_H_
+#define GEOJSON_CPP_GAGO_GEOMETRY_MEMORY_H_
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <unordered_map>
+
+#include <boost/variant.hpp>
+
+#include <gago/macros.h>
+#include <gago/parallel.h>
+#include <gago/geometry/geometry.h>
+#include <gago/geometry/value.h>
+#include <gago/geometry/feature.h>
+
+NS_GAGO_BEGIN
+NS_GEOMETRY_BEGIN
+
+// Bytes held by a collection, by category. Hash map node sizes are those
+// of libstdc++ and heap block headers are not counted, so the figures are
+// close estimates rather than exact.
+struct memory_footprint {
+  // Points of every linestring, ring and multi point.
+  std::size_t coordinates = 0;
+  // Ring, line and polygon objects held by multi geometries and polygons.
+  std::size_t rings = 0;
+  // Top level property keys.
+  std::size_t property_keys = 0;
+  // Property values, including everything nested in them.
+  std::size_t values = 0;
+  // Features themselves, ids, envelopes, hash nodes and buckets, and
+  // unused capacity.
+  std::size_t overhead = 0;
+  // The part of the above that compact() releases.
+  std::size_t slack = 0;
+
+  std::size_t total() const {
+    return coordinates + rings + property_keys + values + overhead;
+  }
+
+  memory_footprint &operator+=(const memory_footprint &other) {
+    coordinates += other.coordinates;
+    rings += other.rings;
+    property_keys += other.property_keys;
+    values += other.values;
+    overhead += other.overhead;
+    slack += other.slack;
+    return *this;
+  }
+};
+
+namespace detail {
+
+inline std::size_t string_heap(const std::string &s) {
+  // Short strings live inside the object.
+  auto data = reinterpret_cast<const char *>(s.data());
+  auto self = reinterpret_cast<const char *>(&s);
+  return data >= self && data < self + sizeof(s) ? 0 : s.capacity() + 1;
+}
+
+template<typename Map>
+void hash_overhead(const Map &map, std::size_t &bytes, std::size_t &slack) {
+  // libstdc++ nodes hold a next pointer and, for string keys, the hash.
+  bytes += map.size() * (sizeof(void *) + sizeof(std::size_t));
+  bytes += map.bucket_count() * sizeof(void *);
+  // Bucket counts are rounded up to a prime, so a rehash keeps up to about
+  // twice what the load factor needs.
+  auto needed = 2 * (std::size_t(std::ceil(map.size() / map.max_load_factor())) + 1);
+  if (map.bucket_count() > needed)
+    slack += (map.bucket_count() - needed) * sizeof(void *);
+}
+
+template<typename V>
+void vector_usage(const std::vector<V> &v, std::size_t &used, memory_footprint &m) {
+  used += v.size() * sizeof(V);
+  m.overhead += (v.capacity() - v.size()) * sizeof(V);
+  m.slack += (v.capacity() - v.size()) * sizeof(V);
+}
+
+struct value_usage : boost::static_visitor<void> {
+  memory_footprint &m;
+
+  explicit value_usage(memory_footprint &m_) : m(m_) {}
+
+  template<typename V>
+  void operator()(const V &) const {}
+
+  void operator()(const std::string &s) const {
+    auto heap = string_heap(s);
+    m.values += heap;
+    if (heap)
+      m.slack += s.capacity() - s.size();
+  }
+
+  void operator()(const std::vector<value> &values) const {
+    vector_usage(values, m.values, m);
+    for (const auto &v : values)
+      boost::apply_visitor(*this, v);
+  }
+
+  void operator()(const std::unordered_map<std::string, value> &map) const {
+    hash_overhead(map, m.values, m.slack);
+    for (const auto &member : map) {
+      m.values += sizeof(member) + string_heap(member.first);
+      boost::apply_visitor(*this, member.second);
+    }
+  }
+};
+
+template<typename T>
+struct geometry_usage {
+  memory_footprint &m;
+
+  template<typename Range>
+  void points(const Range &r) const {
+    vector_usage(static_cast<const std::vector<point<T>> &>(r), m.coordinates, m);
+  }
+
+  void operator()(const point<T> &) const {}
+
+  void operator()(const multi_point<T> &g) const {
+    points(g);
+  }
+
+  void operator()(const linestring<T> &g) const {
+    points(g);
+  }
+
+  void operator()(const multi_linestring<T> &g) const {
+    vector_usage(static_cast<const std::vector<linestring<T>> &>(g), m.rings, m);
+    for (const auto &line : g)
+      points(line);
+  }
+
+  void operator()(const polygon<T> &g) const {
+    points(g.outer());
+    vector_usage(g.inners(), m.rings, m);
+    for (const auto &ring : g.inners())
+      points(ring);
+  }
+
+  void operator()(const multi_polygon<T> &g) const {
+    vector_usage(static_cast<const std::vector<polygon<T>> &>(g), m.rings, m);
+    for (const auto &p : g)
+      (*this)(p);
+  }
+};
+
+struct value_compactor : boost::static_visitor<void> {
+  template<typename V>
+  void operator()(V &) const {}
+
+  void operator()(std::string &s) const {
+    s.shrink_to_fit();
+  }
+
+  void operator()(std::vector<value> &values) const {
+    values.shrink_to_fit();
+    for (auto &v : values)
+      boost::apply_visitor(*this, v);
+  }
+
+  void operator()(std::unordered_map<std::string, value> &map) const {
+    map.rehash(0);
+    for (auto &member : map)
+      boost::apply_visitor(*this, member.second);
+  }
+};
+
+template<typename T>
+struct geometry_compactor {
+  void operator()(point<T> &) const {}
+
+  void operator()(multi_point<T> &g) const {
+    g.shrink_to_fit();
+  }
+
+  void operator()(linestring<T> &g) const {
+    g.shrink_to_fit();
+  }
+
+  void operator()(multi_linestring<T> &g) const {
+    g.shrink_to_fit();
+    for (auto &line : g)
+      line.shrink_to_fit();
+  }
+
+  void operator()(polygon<T> &g) const {
+    g.outer().shrink_to_fit();
+    g.inners().shrink_to_fit();
+    for (auto &ring : g.inners())
+      ring.shrink_to_fit();
+  }
+
+  void operator()(multi_polygon<T> &g) const {
+    g.shrink_to_fit();
+    for (auto &p : g)
+      (*this)(p);
+  }
+};
+
+}  // namespace detail
+
+// Not counting sizeof(feature), which the collection accounts for.
+template<typename T>
+memory_footprint memory_usage(const feature<T> &f) {
+  memory_footprint m;
+  visit(f.geometry, detail::geometry_usage<T>{m});
+
+  detail::hash_overhead(f.properties, m.overhead, m.slack);
+  for (const auto &member : f.properties) {
+    m.property_keys += sizeof(member.first) + detail::string_heap(member.first);
+    m.values += sizeof(member.second);
+    boost::apply_visitor(detail::value_usage(m), member.second);
+  }
+
+  if (f.id) {
+    if (auto s = boost::get<std::string>(&*f.id))
+      m.overhead += detail::string_heap(*s);
+  }
+  detail::vector_usage(f.part_bboxes, m.overhead, m);
+  return m;
+}
+
+template<typename T>
+memory_footprint memory_usage(const feature_collection<T> &features, std::size_t threads = 0) {
+  std::vector<memory_footprint> parts(chunk_count(features.size(), threads));
+  parallel_for_chunks(features.size(), threads, [&](std::size_t chunk, std::size_t begin, std::size_t end) {
+    auto &m = parts[chunk];
+    for (auto i = begin; i < end; i++)
+      m += memory_usage(features[i]);
+  });
+
+  memory_footprint total;
+  for (const auto &m : parts)
+    total += m;
+  detail::vector_usage(static_cast<const std::vector<feature<T>> &>(features), total.overhead, total);
+  return total;
+}
+
+// Releases unused capacity: shrinks every vector and string to its size
+// and rehashes property maps to the fewest buckets their load factor
+// allows. Features are compacted on `threads` threads.
+template<typename T>
+void compact(feature<T> &f) {
+  visit(f.geometry, detail::geometry_compactor<T>{});
+  f.properties.rehash(0);
+  for (auto &member : f.properties)
+    boost::apply_visitor(detail::value_compactor(), member.second);
+  if (f.id) {
+    if (auto s = boost::get<std::string>(&*f.id))
+      s->shrink_to_fit();
+  }
+  f.part_bboxes.shrink_to_fit();
+}
+
+template<typename T>
+void compact(feature_collection<T> &features, std::size_t threads = 0) {
+  parallel_for(features.size(), threads, [&features](std::size_t begin, std::size_t end) {
+    for (auto i = begin; i < end; i++)
+      compact(features[i]);
+  });
+  features.shrink_to_fit();
+}
+
+NS_GEOMETRY_END
+NS_GAGO_END
+
+#endif //  GEOJSON_CPP_GAGO_GEOMETRY_MEMORY_H_
@@ -0,0 +1,395 @@
+//
+// Copyright (c) 2018 ChuiZi (wuqinchun at gagogroup.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef GEOJSON_CPP_GAGO_GEOMETRY_POINT_GRID_H_
+#define GEOJSON_CPP_GAGO_GEOMETRY_POINT_GRID_H_
+
+#include <cmath>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <gago/macros.h>
+#include <gago/parallel.h>
+#include <gago/geometry/box.h>
+#include <gago/geometry/geometry.h>
+#include <gago/geometry/feature.h>
+
+NS_GAGO_BEGIN
+NS_GEOMETRY_BEGIN
+
+namespace detail {
+
+// Square cells of `cell_size` laid over an extent; points outside the
+// extent fall into the nearest edge cell.
+struct grid_layout {
+  double min_x = 0;
+  double min_y = 0;
+  double cell_size = 1;
+  std::size_t columns = 1;
+  std::size_t rows = 1;
+
+  grid_layout() = default;
+
+  grid_layout(const bounds<double> &extent, double cell_size_) : cell_size(cell_size_) {
+    if (!(cell_size > 0))
+      throw std::invalid_argument("grid cell size must be positive");
+    if (extent.empty())
+      return;
+    min_x = extent.min_x;
+    min_y = extent.min_y;
+    columns = std::size_t((extent.max_x - extent.min_x) / cell_size) + 1;
+    rows = std::size_t((extent.max_y - extent.min_y) / cell_size) + 1;
+  }
+
+  std::size_t cells() const {
+    return columns * rows;
+  }
+
+  std::size_t column(double x) const {
+    auto c = (x - min_x) / cell_size;
+    return c <= 0 ? 0 : std::min(columns - 1, std::size_t(c));
+  }
+
+  std::size_t row(double y) const {
+    auto r = (y - min_y) / cell_size;
+    return r <= 0 ? 0 : std::min(rows - 1, std::size_t(r));
+  }
+
+  std::size_t cell(double x, double y) const {
+    return row(y) * columns + column(x);
+  }
+
+  // Calls f(cell) for every cell overlapping the box.
+  template<typename F>
+  void for_each_cell(double min_x_, double min_y_, double max_x_, double max_y_, F &&f) const {
+    auto c0 = column(min_x_), c1 = column(max_x_);
+    auto r0 = row(min_y_), r1 = row(max_y_);
+    for (auto r = r0; r <= r1; r++) {
+      for (auto c = c0; c <= c1; c++)
+        f(r * columns + c);
+    }
+  }
+};
+
+template<typename Grid, typename T, typename F>
+void visit_box(const Grid &grid, const box<T> &b, F &&f) {
+  double min_x = b.min_corner().x(), min_y = b.min_corner().y();
+  double max_x = b.max_corner().x(), max_y = b.max_corner().y();
+  grid.layout().for_each_cell(min_x, min_y, max_x, max_y, [&](std::size_t cell) {
+    grid.for_each_in_cell(cell, [&](std::size_t id, const point<T> &p) {
+      if (p.x() >= min_x && p.x() <= max_x && p.y() >= min_y && p.y() <= max_y)
+        f(id, p);
+    });
+  });
+}
+
+template<typename Grid, typename T, typename F>
+void visit_radius(const Grid &grid, const point<T> &center, double radius, F &&f) {
+  double cx = center.x(), cy = center.y(), sq_radius = radius * radius;
+  grid.layout().for_each_cell(cx - radius, cy - radius, cx + radius, cy + radius,
+                              [&](std::size_t cell) {
+    grid.for_each_in_cell(cell, [&](std::size_t id, const point<T> &p) {
+      double dx = p.x() - cx, dy = p.y() - cy;
+      if (dx * dx + dy * dy <= sq_radius)
+        f(id, p);
+    });
+  });
+}
+
+}  // namespace detail
+
+template<typename T>
+class point_grid;
+
+// Immutable grid index over points with every cell's points stored
+// contiguously, sorted by cell (a CSR layout): a query reads a few short
+// runs of one array. Built in parallel with a counting sort.
+template<typename T>
+class packed_point_grid {
+ public:
+  using entry = std::pair<point<T>, std::size_t>;
+
+  packed_point_grid() : offsets_(2, 0) {}
+
+  // Indexes (point, id) entries; `extent` should cover most of them.
+  packed_point_grid(const std::vector<entry> &entries,
+                    const bounds<double> &extent,
+                    double cell_size,
+                    std::size_t threads = 0)
+      : layout_(extent, cell_size) {
+    build(entries, threads);
+  }
+
+  // Indexes the points of every Point and MultiPoint feature under the
+  // feature's index; other geometries are skipped.
+  static packed_point_grid from_features(const feature_collection<T> &features,
+                                         double cell_size,
+                                         std::size_t threads = 0) {
+    std::vector<entry> entries;
+    bounds<double> extent;
+    for (std::size_t i = 0; i < features.size(); i++) {
+      const auto &g = features[i].geometry;
+      auto type = type_of(g);
+      if (type != geometry_type::POINT && type != geometry_type::MULTIPOINT)
+        continue;
+      gago::geometry::for_each_point(g, [&](const point<T> &p) {
+        entries.emplace_back(p, i);
+        extent.expand(double(p.x()), double(p.y()));
+      });
+    }
+    return packed_point_grid(entries, extent, cell_size, threads);
+  }
+
+  std::size_t size() const {
+    return ids_.size();
+  }
+
+  const detail::grid_layout &layout() const {
+    return layout_;
+  }
+
+  template<typename F>
+  void for_each_in_cell(std::size_t cell, F &&f) const {
+    for (auto i = offsets_[cell]; i < offsets_[cell + 1]; i++)
+      f(ids_[i], points_[i]);
+  }
+
+  // Calls f(id, point) for every point inside the box, edges included.
+  template<typename F>
+  void visit(const box<T> &b, F &&f) const {
+    detail::visit_box(*this, b, f);
+  }
+
+  // Calls f(id, point) for every point within `radius` of `center`.
+  template<typename F>
+  void visit(const point<T> &center, double radius, F &&f) const {
+    detail::visit_radius(*this, center, radius, f);
+  }
+
+  std::vector<std::size_t> query(const box<T> &b) const {
+    std::vector<std::size_t> ids;
+    visit(b, [&ids](std::size_t id, const point<T> &) { ids.push_back(id); });
+    return ids;
+  }
+
+  std::vector<std::size_t> query(const point<T> &center, double radius) const {
+    std::vector<std::size_t> ids;
+    visit(center, radius, [&ids](std::size_t id, const point<T> &) { ids.push_back(id); });
+    return ids;
+  }
+
+ private:
+  friend class point_grid<T>;
+
+  void build(const std::vector<entry> &entries, std::size_t threads) {
+    auto count = entries.size();
+    auto cells = layout_.cells();
+    // Per chunk histograms, turned into each chunk's write position per
+    // cell, keep the sort stable and the scatter free of contention.
+    std::vector<std::uint32_t> cell_of(count);
+    std::vector<std::vector<std::size_t>> positions(chunk_count(count, threads),
+                                                    std::vector<std::size_t>(cells, 0));
+    parallel_for_chunks(count, threads, [&](std::size_t chunk, std::size_t begin, std::size_t end) {
+      auto &histogram = positions[chunk];
+      for (auto i = begin; i < end; i++) {
+        const auto &p = entries[i].first;
+        cell_of[i] = std::uint32_t(layout_.cell(double(p.x()), double(p.y())));
+        histogram[cell_of[i]]++;
+      }
+    });
+
+    offsets_.assign(cells + 1, 0);
+    std::size_t position = 0;
+    for (std::size_t cell = 0; cell < cells; cell++) {
+      offsets_[cell] = position;
+      for (auto &histogram : positions) {
+        auto n = histogram[cell];
+        histogram[cell] = position;
+        position += n;
+      }
+    }
+    offsets_[cells] = position;
+
+    points_.resize(count);
+    ids_.resize(count);
+    parallel_for_chunks(count, threads, [&](std::size_t chunk, std::size_t begin, std::size_t end) {
+      auto &next = positions[chunk];
+      for (auto i = begin; i < end; i++) {
+        auto at = next[cell_of[i]]++;
+        points_[at] = entries[i].first;
+        ids_[at] = entries[i].second;
+      }
+    });
+  }
+
+  detail::grid_layout layout_;
+  std::vector<std::size_t> offsets_;
+  std::vector<point<T>> points_;
+  std::vector<std::size_t> ids_;
+};
+
+// Mutable grid index over points keyed by id, for points that come, go
+// and move all the time: insert, move and remove are O(1) on average.
+// pack() takes a compact, immutable copy for query heavy readers.
+//
+// Also usable as a feature_store Index policy, indexing the center of each
+// feature's envelope under its slot.
+template<typename T>
+class point_grid {
+ public:
+  using entry = std::pair<point<T>, std::size_t>;
+
+  point_grid(const box<T> &extent, double cell_size)
+      : layout_(to_bounds(extent), cell_size), cells_(layout_.cells()) {}
+
+  std::size_t size() const {
+    return locations_.size();
+  }
+
+  const detail::grid_layout &layout() const {
+    return layout_;
+  }
+
+  bool contains(std::size_t id) const {
+    return locations_.count(id) != 0;
+  }
+
+  // Adds a point, or moves it if the id is already indexed.
+  void insert(std::size_t id, const point<T> &p) {
+    auto cell = layout_.cell(double(p.x()), double(p.y()));
+    auto it = locations_.find(id);
+    if (it != locations_.end()) {
+      if (it->second.cell == cell) {
+        cells_[cell][it->second.index].first = p;
+        return;
+      }
+      unlink(it->second);
+      it->second = location{cell, cells_[cell].size()};
+    } else {
+      locations_.emplace(id, location{cell, cells_[cell].size()});
+    }
+    cells_[cell].emplace_back(p, id);
+  }
+
+  bool remove(std::size_t id) {
+    auto it = locations_.find(id);
+    if (it == locations_.end())
+      return false;
+    unlink(it->second);
+    locations_.erase(it);
+    return true;
+  }
+
+  void clear() {
+    for (auto &cell : cells_)
+      cell.clear();
+    locations_.clear();
+  }
+
+  // Index policy interface.
+  void insert(std::size_t slot, const box<T> &b) {
+    insert(slot, point<T>((b.min_corner().x() + b.max_corner().x()) / 2,
+                          (b.min_corner().y() + b.max_corner().y()) / 2));
+  }
+
+  void remove(std::size_t slot, const box<T> &) {
+    remove(slot);
+  }
+
+  template<typename F>
+  void for_each_in_cell(std::size_t cell, F &&f) const {
+    for (const auto &e : cells_[cell])
+      f(e.second, e.first);
+  }
+
+  template<typename F>
+  void visit(const box<T> &b, F &&f) const {
+    detail::visit_box(*this, b, f);
+  }
+
+  template<typename F>
+  void visit(const point<T> &center, double radius, F &&f) const {
+    detail::visit_radius(*this, center, radius, f);
+  }
+
+  std::vector<std::size_t> query(const box<T> &b) const {
+    std::vector<std::size_t> ids;
+    visit(b, [&ids](std::size_t id, const point<T> &) { ids.push_back(id); });
+    return ids;
+  }
+
+  std::vector<std::size_t> query(const point<T> &center, double radius) const {
+    std::vector<std::size_t> ids;
+    visit(center, radius, [&ids](std::size_t id, const point<T> &) { ids.push_back(id); });
+    return ids;
+  }
+
+  // Compact copy on the same cells, built on `threads` threads.
+  packed_point_grid<T> pack(std::size_t threads = 0) const {
+    std::vector<entry> entries;
+    entries.reserve(size());
+    for (const auto &cell : cells_)
+      entries.insert(entries.end(), cell.begin(), cell.end());
+
+    packed_point_grid<T> packed;
+    packed.layout_ = layout_;
+    packed.build(entries, threads);
+    return packed;
+  }
+
+ private:
+  struct location {
+    std::size_t cell;
+    std::size_t index;
+  };
+
+  static bounds<double> to_bounds(const box<T> &b) {
+    bounds<double> extent;
+    extent.expand(double(b.min_corner().x()), double(b.min_corner().y()));
+    extent.expand(double(b.max_corner().x()), double(b.max_corner().y()));
+    return extent;
+  }
+
+  // Removes an entry by moving the cell's last entry into its place.
+  void unlink(const location &at) {
+    auto &cell = cells_[at.cell];
+    if (at.index + 1 != cell.size()) {
+      cell[at.index] = cell.back();
+      locations_[cell[at.index].second].index = at.index;
+    }
+    cell.pop_back();
+  }
+
+  detail::grid_layout layout_;
+  std::vector<std::vector<entry>> cells_;
+  std::unordered_map<std::size_t, location> locations_;
+};
+
+NS_GEOMETRY_END
+NS_GAGO_END
+
+#endif //  GEOJSON_CPP_GAGO_GEOMETRY_POINT_GRID_H_
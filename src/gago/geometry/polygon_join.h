@@ -0,0 +1,242 @@
+//
+// Copyright (c) 2018 ChuiZi (wuqinchun at gagogroup.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef GEOJSON_CPP_GAGO_GEOMETRY_POLYGON_JOIN_H_
+#define GEOJSON_CPP_GAGO_GEOMETRY_POLYGON_JOIN_H_
+
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+
+#include <boost/variant.hpp>
+#include <boost/geometry/index/rtree.hpp>
+
+#include <gago/macros.h>
+#include <gago/parallel.h>
+#include <gago/geometry/box.h>
+#include <gago/geometry/feature.h>
+
+NS_GAGO_BEGIN
+NS_GEOMETRY_BEGIN
+
+namespace detail {
+
+// A polygonal geometry prepared for repeated point-in-polygon tests: its
+// edges are bucketed into horizontal bands so a test only looks at the
+// edges crossing the point's band. Rings of all parts are tested together
+// with the even-odd rule, which handles holes and multi-polygons alike.
+class prepared_polygon {
+ public:
+  template<typename T>
+  explicit prepared_polygon(const geometry<T> &g) {
+    switch (type_of(g)) {
+      case geometry_type::POLYGON:
+        add_polygon(boost::get<polygon<T>>(g));
+        break;
+      case geometry_type::MULTIPOLYGON:
+        for (const auto &p : boost::get<multi_polygon<T>>(g))
+          add_polygon(p);
+        break;
+      default:
+        break;
+    }
+    build_bands();
+  }
+
+  bool empty() const {
+    return edges_.empty();
+  }
+
+  const bounds<double> &envelope() const {
+    return envelope_;
+  }
+
+  bool contains(double x, double y) const {
+    if (edges_.empty() || y < envelope_.min_y || y > envelope_.max_y
+        || x < envelope_.min_x || x > envelope_.max_x)
+      return false;
+
+    auto band = std::size_t((y - envelope_.min_y) * scale_);
+    if (band >= offsets_.size() - 1)
+      band = offsets_.size() - 2;
+
+    bool inside = false;
+    for (auto i = offsets_[band]; i < offsets_[band + 1]; i++) {
+      const auto &e = edges_[band_edges_[i]];
+      if ((e.y1 > y) != (e.y2 > y)
+          && x < (e.x2 - e.x1) * (y - e.y1) / (e.y2 - e.y1) + e.x1)
+        inside = !inside;
+    }
+    return inside;
+  }
+
+ private:
+  struct edge {
+    double x1, y1, x2, y2;
+  };
+
+  template<typename Ring>
+  void add_ring(const Ring &ring) {
+    // Unclosed rings are closed implicitly by wrapping around.
+    for (std::size_t i = 0; i < ring.size(); i++) {
+      const auto &b = ring[i + 1 < ring.size() ? i + 1 : 0];
+      edge e{double(ring[i].x()), double(ring[i].y()), double(b.x()), double(b.y())};
+      envelope_.expand(e.x1, e.y1);
+      // Horizontal edges never cross a ray cast along the x axis.
+      if (e.y1 != e.y2)
+        edges_.push_back(e);
+    }
+  }
+
+  template<typename Polygon>
+  void add_polygon(const Polygon &p) {
+    add_ring(p.outer());
+    for (const auto &ring : p.inners())
+      add_ring(ring);
+  }
+
+  void build_bands() {
+    if (edges_.empty())
+      return;
+
+    auto count = std::max<std::size_t>(1, std::min<std::size_t>(edges_.size() / 2, 1 << 16));
+    auto height = envelope_.max_y - envelope_.min_y;
+    scale_ = height > 0 ? count / height : 0;
+
+    auto range = [&](const edge &e) {
+      auto lo = std::min(e.y1, e.y2), hi = std::max(e.y1, e.y2);
+      auto first = std::min(count - 1, std::size_t((lo - envelope_.min_y) * scale_));
+      auto last = std::min(count - 1, std::size_t((hi - envelope_.min_y) * scale_));
+      return std::make_pair(first, last);
+    };
+
+    offsets_.assign(count + 1, 0);
+    for (const auto &e : edges_) {
+      auto r = range(e);
+      for (auto b = r.first; b <= r.second; b++)
+        offsets_[b + 1]++;
+    }
+    for (std::size_t b = 0; b < count; b++)
+      offsets_[b + 1] += offsets_[b];
+
+    band_edges_.resize(offsets_.back());
+    auto fill = offsets_;
+    for (std::uint32_t i = 0; i < edges_.size(); i++) {
+      auto r = range(edges_[i]);
+      for (auto b = r.first; b <= r.second; b++)
+        band_edges_[fill[b]++] = i;
+    }
+  }
+
+  std::vector<edge> edges_;
+  std::vector<std::uint32_t> offsets_;
+  std::vector<std::uint32_t> band_edges_;
+  bounds<double> envelope_;
+  double scale_ = 0;
+};
+
+}  // namespace detail
+
+// Assigns points to the polygonal features of a collection. Feature
+// envelopes are packed into an R-tree and every polygon is prepared once,
+// so joining a batch only costs an index lookup and a banded edge scan
+// per point. A built polygon_join can be queried from several threads.
+template<typename T>
+class polygon_join {
+ public:
+  static constexpr std::size_t npos = std::size_t(-1);
+
+  explicit polygon_join(const feature_collection<T> &features) {
+    std::vector<value_type> values;
+    for (std::size_t i = 0; i < features.size(); i++) {
+      detail::prepared_polygon prepared(features[i].geometry);
+      if (prepared.empty())
+        continue;
+
+      auto envelope = prepared.envelope().to_box();
+      if (features[i].bbox)
+        envelope = box<double>(point<double>(features[i].bbox->min_corner().x(),
+                                             features[i].bbox->min_corner().y()),
+                               point<double>(features[i].bbox->max_corner().x(),
+                                             features[i].bbox->max_corner().y()));
+
+      values.emplace_back(envelope, polygons_.size());
+      polygons_.push_back(std::move(prepared));
+      indices_.push_back(i);
+    }
+    index_ = rtree_type(values.begin(), values.end());
+  }
+
+  // Index of the lowest-numbered feature containing `p`, or npos.
+  std::size_t locate(const point<T> &p) const {
+    std::vector<value_type> candidates;
+    return locate(p, candidates);
+  }
+
+  // Locates every point of `points`, spread over `threads` threads (zero
+  // means one per hardware thread).
+  template<typename Range>
+  std::vector<std::size_t> join(const Range &points, std::size_t threads = 0) const {
+    std::vector<std::size_t> result(points.size(), npos);
+
+    parallel_for(points.size(), threads, [&](std::size_t begin, std::size_t end) {
+      std::vector<value_type> candidates;
+      for (auto i = begin; i < end; i++)
+        result[i] = locate(points[i], candidates);
+    });
+    return result;
+  }
+
+ private:
+  using value_type = std::pair<box<double>, std::size_t>;
+  using rtree_type = boost::geometry::index::rtree<value_type,
+                                                   boost::geometry::index::rstar<16>>;
+
+  template<typename Point>
+  std::size_t locate(const Point &p, std::vector<value_type> &candidates) const {
+    point<double> q(p.x(), p.y());
+    candidates.clear();
+    index_.query(boost::geometry::index::intersects(q), std::back_inserter(candidates));
+
+    auto found = npos;
+    for (const auto &candidate : candidates) {
+      auto feature = indices_[candidate.second];
+      if (feature < found && polygons_[candidate.second].contains(q.x(), q.y()))
+        found = feature;
+    }
+    return found;
+  }
+
+  std::vector<detail::prepared_polygon> polygons_;
+  std::vector<std::size_t> indices_;
+  rtree_type index_;
+};
+
+template<typename T>
+constexpr std::size_t polygon_join<T>::npos;
+
+NS_GEOMETRY_END
+NS_GAGO_END
+
+#endif //  GEOJSON_CPP_GAGO_GEOMETRY_POLYGON_JOIN_H_
@@ -0,0 +1,278 @@
+//
+// Copyright (c) 2018 ChuiZi (wuqinchun at gagogroup.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef GEOJSON_CPP_GAGO_GEOMETRY_PROJECTION_H_
+#define GEOJSON_CPP_GAGO_GEOMETRY_PROJECTION_H_
+
+#include <cmath>
+#include <cstddef>
+#include <type_traits>
+
+#include <boost/geometry/core/tags.hpp>
+#include <boost/geometry/core/tag.hpp>
+
+#include <gago/macros.h>
+#include <gago/parallel.h>
+#include <gago/geometry/box.h>
+#include <gago/geometry/feature.h>
+#include <gago/geometry/geometry.h>
+#include <gago/geometry/kernels.h>
+
+NS_GAGO_BEGIN
+NS_GEOMETRY_BEGIN
+
+// Coordinate transforms work on whole arrays of points, so they can be run
+// once per ring as it is converted. Each one is a functor called as
+// f(point<double> *points, std::size_t count) and rewrites the points in
+// place. Geographic coordinates are longitude, latitude in degrees.
+
+namespace detail {
+
+constexpr double wgs84_a = 6378137.0;
+constexpr double wgs84_f = 1 / 298.257223563;
+constexpr double to_radians = M_PI / 180;
+constexpr double to_degrees = 180 / M_PI;
+
+// Coefficients of Krüger's series for the transverse Mercator projection,
+// to third order in the third flattening n.
+struct kruger {
+  double n;
+  double a;
+  double alpha[3];
+  double beta[3];
+  double delta[3];
+  double e;
+
+  kruger() {
+    n = wgs84_f / (2 - wgs84_f);
+    auto n2 = n * n, n3 = n2 * n;
+    a = wgs84_a / (1 + n) * (1 + n2 / 4 + n2 * n2 / 64);
+    alpha[0] = n / 2 - 2 * n2 / 3 + 5 * n3 / 16;
+    alpha[1] = 13 * n2 / 48 - 3 * n3 / 5;
+    alpha[2] = 61 * n3 / 240;
+    beta[0] = n / 2 - 2 * n2 / 3 + 37 * n3 / 96;
+    beta[1] = n2 / 48 + n3 / 15;
+    beta[2] = 17 * n3 / 480;
+    delta[0] = 2 * n - 2 * n2 / 3 - 2 * n3;
+    delta[1] = 7 * n2 / 3 - 8 * n3 / 5;
+    delta[2] = 56 * n3 / 15;
+    e = 2 * std::sqrt(n) / (1 + n);
+  }
+
+  static const kruger &wgs84() {
+    static const kruger coefficients;
+    return coefficients;
+  }
+};
+
+constexpr double utm_k0 = 0.9996;
+constexpr double utm_false_easting = 500000;
+constexpr double utm_false_northing_south = 10000000;
+
+inline double utm_central_meridian(int zone) {
+  return (zone * 6 - 183) * to_radians;
+}
+
+}  // namespace detail
+
+// Zone number, 1 to 60, whose central meridian is closest to `lon`.
+inline int utm_zone(double lon) {
+  auto zone = int(std::floor((lon + 180) / 6)) + 1;
+  return zone < 1 ? 1 : zone > 60 ? 60 : zone;
+}
+
+struct wgs84_to_web_mercator {
+  void operator()(point<double> *points, std::size_t count) const {
+    const double max_lat = 85.0511287798066;
+    auto *xy = reinterpret_cast<double *>(points);
+    for (std::size_t i = 0; i < count; i++) {
+      auto lat = xy[2 * i + 1];
+      lat = lat > max_lat ? max_lat : lat < -max_lat ? -max_lat : lat;
+      xy[2 * i] = detail::wgs84_a * xy[2 * i] * detail::to_radians;
+      xy[2 * i + 1] = detail::wgs84_a * std::log(std::tan(M_PI / 4 + lat * detail::to_radians / 2));
+    }
+  }
+};
+
+struct web_mercator_to_wgs84 {
+  void operator()(point<double> *points, std::size_t count) const {
+    auto *xy = reinterpret_cast<double *>(points);
+    for (std::size_t i = 0; i < count; i++) {
+      xy[2 * i] = xy[2 * i] / detail::wgs84_a * detail::to_degrees;
+      xy[2 * i + 1] = (2 * std::atan(std::exp(xy[2 * i + 1] / detail::wgs84_a)) - M_PI / 2)
+          * detail::to_degrees;
+    }
+  }
+};
+
+struct wgs84_to_utm {
+  int zone;
+  bool north;
+
+  explicit wgs84_to_utm(int zone_, bool north_ = true) : zone(zone_), north(north_) {}
+
+  void operator()(point<double> *points, std::size_t count) const {
+    const auto &k = detail::kruger::wgs84();
+    auto lon0 = detail::utm_central_meridian(zone);
+    auto scale = detail::utm_k0 * k.a;
+    auto false_northing = north ? 0 : detail::utm_false_northing_south;
+
+    auto *xy = reinterpret_cast<double *>(points);
+    for (std::size_t i = 0; i < count; i++) {
+      auto lon = xy[2 * i] * detail::to_radians - lon0;
+      auto sin_lat = std::sin(xy[2 * i + 1] * detail::to_radians);
+      auto t = std::sinh(std::atanh(sin_lat) - k.e * std::atanh(k.e * sin_lat));
+      auto xi = std::atan2(t, std::cos(lon));
+      auto eta = std::atanh(std::sin(lon) / std::sqrt(1 + t * t));
+
+      auto easting = eta, northing = xi;
+      for (int j = 0; j < 3; j++) {
+        auto m = 2.0 * (j + 1);
+        easting += k.alpha[j] * std::cos(m * xi) * std::sinh(m * eta);
+        northing += k.alpha[j] * std::sin(m * xi) * std::cosh(m * eta);
+      }
+
+      xy[2 * i] = detail::utm_false_easting + scale * easting;
+      xy[2 * i + 1] = false_northing + scale * northing;
+    }
+  }
+};
+
+struct utm_to_wgs84 {
+  int zone;
+  bool north;
+
+  explicit utm_to_wgs84(int zone_, bool north_ = true) : zone(zone_), north(north_) {}
+
+  void operator()(point<double> *points, std::size_t count) const {
+    const auto &k = detail::kruger::wgs84();
+    auto lon0 = detail::utm_central_meridian(zone);
+    auto scale = detail::utm_k0 * k.a;
+    auto false_northing = north ? 0 : detail::utm_false_northing_south;
+
+    auto *xy = reinterpret_cast<double *>(points);
+    for (std::size_t i = 0; i < count; i++) {
+      auto xi = (xy[2 * i + 1] - false_northing) / scale;
+      auto eta = (xy[2 * i] - detail::utm_false_easting) / scale;
+
+      auto xi1 = xi, eta1 = eta;
+      for (int j = 0; j < 3; j++) {
+        auto m = 2.0 * (j + 1);
+        xi1 -= k.beta[j] * std::sin(m * xi) * std::cosh(m * eta);
+        eta1 -= k.beta[j] * std::cos(m * xi) * std::sinh(m * eta);
+      }
+
+      auto chi = std::asin(std::sin(xi1) / std::cosh(eta1));
+      auto lat = chi;
+      for (int j = 0; j < 3; j++)
+        lat += k.delta[j] * std::sin(2.0 * (j + 1) * chi);
+
+      xy[2 * i] = (lon0 + std::atan2(std::sinh(eta1), std::cos(xi1))) * detail::to_degrees;
+      xy[2 * i + 1] = lat * detail::to_degrees;
+    }
+  }
+};
+
+namespace detail {
+
+template<typename Geometry, typename F>
+void transform(Geometry &g, const F &f, boost::geometry::point_tag) {
+  f(&g, 1);
+}
+
+template<typename Geometry, typename F>
+void transform(Geometry &g, const F &f, boost::geometry::multi_point_tag) {
+  f(g.data(), g.size());
+}
+
+template<typename Geometry, typename F>
+void transform(Geometry &g, const F &f, boost::geometry::linestring_tag) {
+  f(g.data(), g.size());
+}
+
+template<typename Geometry, typename F>
+void transform(Geometry &g, const F &f, boost::geometry::multi_linestring_tag) {
+  for (auto &line : g)
+    f(line.data(), line.size());
+}
+
+template<typename Geometry, typename F>
+void transform(Geometry &g, const F &f, boost::geometry::polygon_tag) {
+  f(g.outer().data(), g.outer().size());
+  for (auto &ring : g.inners())
+    f(ring.data(), ring.size());
+}
+
+template<typename Geometry, typename F>
+void transform(Geometry &g, const F &f, boost::geometry::multi_polygon_tag) {
+  for (auto &p : g)
+    transform(p, f, boost::geometry::polygon_tag());
+}
+
+}  // namespace detail
+
+// Applies a coordinate transform to an already converted geometry, one
+// ring or line at a time.
+template<typename F>
+void transform(geometry<double> &g, const F &f) {
+  visit(g, [&f](auto &held) -> void {
+    using tag = typename boost::geometry::tag<typename std::decay<decltype(held)>::type>::type;
+    detail::transform(held, f, tag());
+  });
+}
+
+// Transforms every feature of a collection across `threads` threads (zero
+// means one per hardware thread). Cached bounding boxes are recomputed in
+// the new coordinates.
+template<typename F>
+void transform(feature_collection<double> &features, const F &f, std::size_t threads = 0) {
+  parallel_for(features.size(), threads, [&](std::size_t begin, std::size_t end) {
+    for (auto i = begin; i < end; i++) {
+      auto &feature = features[i];
+      transform(feature.geometry, f);
+
+      if (feature.bbox)
+        feature.bbox = kernels::envelope(feature.geometry).to_box();
+
+      if (feature.part_bboxes.empty())
+        continue;
+      if (type_of(feature.geometry) == geometry_type::MULTIPOINT) {
+        const auto &points = boost::get<multi_point<double>>(feature.geometry);
+        for (std::size_t j = 0; j < points.size(); j++)
+          feature.part_bboxes[j] = box<double>(points[j], points[j]);
+      } else if (type_of(feature.geometry) == geometry_type::MULTILINESTRING) {
+        const auto &lines = boost::get<multi_linestring<double>>(feature.geometry);
+        for (std::size_t j = 0; j < lines.size(); j++)
+          feature.part_bboxes[j] = kernels::envelope(lines[j]).to_box();
+      } else if (type_of(feature.geometry) == geometry_type::MULTIPOLYGON) {
+        const auto &polygons = boost::get<multi_polygon<double>>(feature.geometry);
+        for (std::size_t j = 0; j < polygons.size(); j++)
+          feature.part_bboxes[j] = kernels::envelope(polygons[j]).to_box();
+      }
+    }
+  });
+}
+
+NS_GEOMETRY_END
+NS_GAGO_END
+
+#endif //  GEOJSON_CPP_GAGO_GEOMETRY_PROJECTION_H_
@@ -0,0 +1,446 @@
+//
+// Copyright (c) 2018 ChuiZi (wuqinchun at gagogroup.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef GEOJSON_CPP_GAGO_GEOMETRY_RASTERIZE_H_
+#define GEOJSON_CPP_GAGO_GEOMETRY_RASTERIZE_H_
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+
+#include <boost/variant.hpp>
+
+#include <gago/macros.h>
+#include <gago/parallel.h>
+#include <gago/geometry/box.h>
+#include <gago/geometry/geometry.h>
+#include <gago/geometry/value.h>
+#include <gago/geometry/feature.h>
+
+NS_GAGO_BEGIN
+NS_GEOMETRY_BEGIN
+
+enum class raster_mode {
+  // Number of features covering each cell.
+  COUNT = 0,
+  // Sum of a numeric property over the features covering each cell.
+  SUM,
+  // Largest value of a numeric property among the features covering
+  // each cell, or 0 for cells no feature covers.
+  MAX
+};
+
+struct raster_options {
+  std::size_t width = 256;
+  std::size_t height = 256;
+  // Area covered by the raster.
+  box<double> extent{point<double>(0, 0), point<double>(1, 1)};
+  raster_mode mode = raster_mode::COUNT;
+  // Numeric property for SUM and MAX; features without a numeric value
+  // are skipped.
+  std::string property;
+  // Without anti-aliasing a polygon covers the cells whose centers it
+  // contains. With it, polygons add their coverage of each cell, measured
+  // exactly along rows and by `samples` scanlines across them; lines and
+  // points always cover the cells they touch.
+  bool antialias = false;
+  std::size_t samples = 4;
+  // Threads, each burning a band of rows; zero means one per hardware
+  // thread.
+  std::size_t threads = 0;
+};
+
+// Cells in row-major order, row 0 at the top (largest y) of the extent.
+struct raster {
+  std::size_t width = 0;
+  std::size_t height = 0;
+  box<double> extent;
+  std::vector<double> values;
+
+  double at(std::size_t column, std::size_t row) const {
+    return values[row * width + column];
+  }
+};
+
+namespace detail {
+
+// A feature prepared for burning, in pixel coordinates: x grows by one per
+// column and y by one per row, downwards.
+struct raster_shape {
+  double weight = 1;
+  bool skip = false;
+  bounds<double> envelope;
+  // Polygon edges, y0 < y1, sorted by y0.
+  struct edge {
+    double x0, y0, x1, y1;
+  };
+  std::vector<edge> edges;
+  // Line segments and points.
+  std::vector<edge> segments;
+  std::vector<point<double>> points;
+};
+
+struct number_visitor : boost::static_visitor<bool> {
+  double &result;
+
+  explicit number_visitor(double &result_) : result(result_) {}
+
+  bool operator()(std::uint64_t u) const {
+    result = double(u);
+    return true;
+  }
+
+  bool operator()(std::int64_t i) const {
+    result = double(i);
+    return true;
+  }
+
+  bool operator()(double d) const {
+    result = d;
+    return true;
+  }
+
+  template<typename V>
+  bool operator()(const V &) const {
+    return false;
+  }
+};
+
+template<typename T>
+class shape_builder {
+ public:
+  shape_builder(const raster_options &options, raster_shape &shape) : shape_(shape) {
+    min_x_ = options.extent.min_corner().x();
+    max_y_ = options.extent.max_corner().y();
+    sx_ = options.width / (options.extent.max_corner().x() - min_x_);
+    sy_ = options.height / (max_y_ - options.extent.min_corner().y());
+  }
+
+  point<double> to_pixel(const point<T> &p) const {
+    return point<double>((p.x() - min_x_) * sx_, (max_y_ - p.y()) * sy_);
+  }
+
+  void add(const geometry<T> &g) {
+    visit(g, *this);
+  }
+
+  void operator()(const point<T> &p) {
+    add_point(to_pixel(p));
+  }
+
+  void operator()(const multi_point<T> &g) {
+    for (const auto &p : g)
+      add_point(to_pixel(p));
+  }
+
+  void operator()(const linestring<T> &g) {
+    add_path(g, shape_.segments);
+  }
+
+  void operator()(const multi_linestring<T> &g) {
+    for (const auto &line : g)
+      add_path(line, shape_.segments);
+  }
+
+  void operator()(const polygon<T> &g) {
+    add_path(g.outer(), shape_.edges);
+    for (const auto &ring : g.inners())
+      add_path(ring, shape_.edges);
+  }
+
+  void operator()(const multi_polygon<T> &g) {
+    for (const auto &p : g)
+      (*this)(p);
+  }
+
+  void finish() {
+    std::sort(shape_.edges.begin(), shape_.edges.end(),
+              [](const raster_shape::edge &a, const raster_shape::edge &b) { return a.y0 < b.y0; });
+  }
+
+ private:
+  void add_point(const point<double> &p) {
+    shape_.points.push_back(p);
+    shape_.envelope.expand(p);
+  }
+
+  template<typename Range>
+  void add_path(const Range &path, std::vector<raster_shape::edge> &out) {
+    bool polygon = &out == &shape_.edges;
+    for (std::size_t i = 1; i < path.size(); i++) {
+      auto a = to_pixel(path[i - 1]), b = to_pixel(path[i]);
+      shape_.envelope.expand(a);
+      shape_.envelope.expand(b);
+      if (!polygon) {
+        out.push_back(raster_shape::edge{a.x(), a.y(), b.x(), b.y()});
+      } else if (a.y() != b.y()) {
+        // Horizontal edges never cross a scanline.
+        if (a.y() > b.y())
+          std::swap(a, b);
+        out.push_back(raster_shape::edge{a.x(), a.y(), b.x(), b.y()});
+      }
+    }
+    if (path.size() == 1)
+      add_point(to_pixel(path[0]));
+  }
+
+  raster_shape &shape_;
+  double min_x_, max_y_, sx_, sy_;
+};
+
+// Burns shapes into rows [row0, row1) of a raster.
+class band_burner {
+ public:
+  band_burner(raster &r, const raster_options &options, std::size_t row0, std::size_t row1)
+      : raster_(r), options_(options), row0_(row0), row1_(row1),
+        stamps_((row1 - row0) * r.width, 0), coverage_(r.width, 0) {}
+
+  void burn(const raster_shape &shape, std::uint32_t stamp) {
+    if (shape.skip || shape.envelope.empty()
+        || shape.envelope.max_y < double(row0_) || shape.envelope.min_y >= double(row1_)
+        || shape.envelope.max_x < 0 || shape.envelope.min_x >= double(raster_.width))
+      return;
+
+    weight_ = shape.weight;
+    stamp_ = stamp;
+    if (!shape.edges.empty())
+      fill(shape);
+    for (const auto &s : shape.segments) {
+      auto clipped = s;
+      if (clip(clipped))
+        trace(clipped);
+    }
+    for (const auto &p : shape.points)
+      mark(p.x(), p.y());
+  }
+
+ private:
+  void apply(std::size_t column, std::size_t row, double coverage) {
+    auto &v = raster_.values[row * raster_.width + column];
+    switch (options_.mode) {
+      case raster_mode::COUNT:
+        v += coverage;
+        break;
+      case raster_mode::SUM:
+        v += coverage * weight_;
+        break;
+      case raster_mode::MAX:
+        v = std::max(v, coverage * weight_);
+        break;
+    }
+  }
+
+  // Covers a cell once per shape, for lines and points.
+  void mark(double x, double y) {
+    if (x < 0 || y < double(row0_) || x >= double(raster_.width) || y >= double(row1_))
+      return;
+    auto column = std::size_t(x), row = std::size_t(y);
+    auto &stamp = stamps_[(row - row0_) * raster_.width + column];
+    if (stamp == stamp_)
+      return;
+    stamp = stamp_;
+    apply(column, row, 1);
+  }
+
+  // Clips a segment to the band (Liang & Barsky); false if it misses.
+  bool clip(raster_shape::edge &s) const {
+    double t0 = 0, t1 = 1;
+    double dx = s.x1 - s.x0, dy = s.y1 - s.y0;
+    double p[] = {-dx, dx, -dy, dy};
+    double q[] = {s.x0, double(raster_.width) - s.x0, s.y0 - double(row0_), double(row1_) - s.y0};
+    for (int i = 0; i < 4; i++) {
+      if (p[i] == 0) {
+        if (q[i] < 0)
+          return false;
+        continue;
+      }
+      auto t = q[i] / p[i];
+      if (p[i] < 0)
+        t0 = std::max(t0, t);
+      else
+        t1 = std::min(t1, t);
+    }
+    if (t0 > t1)
+      return false;
+    s = raster_shape::edge{s.x0 + t0 * dx, s.y0 + t0 * dy, s.x0 + t1 * dx, s.y0 + t1 * dy};
+    return true;
+  }
+
+  // Visits every cell a segment passes through (Amanatides & Woo).
+  void trace(const raster_shape::edge &s) {
+    double x = s.x0, y = s.y0;
+    double dx = s.x1 - s.x0, dy = s.y1 - s.y0;
+    auto column = std::floor(x), row = std::floor(y);
+    auto last_column = std::floor(s.x1), last_row = std::floor(s.y1);
+    int step_x = dx > 0 ? 1 : -1, step_y = dy > 0 ? 1 : -1;
+    double inf = std::numeric_limits<double>::infinity();
+    double delta_x = dx != 0 ? std::abs(1 / dx) : inf;
+    double delta_y = dy != 0 ? std::abs(1 / dy) : inf;
+    double next_x = dx != 0 ? ((dx > 0 ? column + 1 - x : x - column) * delta_x) : inf;
+    double next_y = dy != 0 ? ((dy > 0 ? row + 1 - y : y - row) * delta_y) : inf;
+
+    mark(column, row);
+    auto steps = std::abs(last_column - column) + std::abs(last_row - row);
+    for (double i = 0; i < steps; i++) {
+      if (next_x < next_y) {
+        column += step_x;
+        next_x += delta_x;
+      } else {
+        row += step_y;
+        next_y += delta_y;
+      }
+      mark(column, row);
+    }
+  }
+
+  // Even-odd scanline fill over an edge table.
+  void fill(const raster_shape &shape) {
+    const auto &edges = shape.edges;
+    std::size_t samples = options_.antialias ? std::max<std::size_t>(1, options_.samples) : 1;
+    std::size_t next = 0;
+    active_.clear();
+
+    auto first_row = std::max(row0_, std::size_t(std::max(0.0, std::floor(shape.envelope.min_y))));
+    auto end_row = std::min(row1_, std::size_t(std::max(0.0, std::ceil(shape.envelope.max_y))) + 1);
+    for (auto row = first_row; row < end_row; row++) {
+      std::size_t touched_min = raster_.width, touched_max = 0;
+      for (std::size_t k = 0; k < samples; k++) {
+        double y = row + (k + 0.5) / samples;
+        while (next < edges.size() && edges[next].y0 <= y)
+          active_.push_back(&edges[next++]);
+        active_.erase(std::remove_if(active_.begin(), active_.end(),
+                                     [y](const raster_shape::edge *e) { return e->y1 <= y; }),
+                      active_.end());
+        if (active_.empty())
+          continue;
+
+        crossings_.clear();
+        for (auto e : active_)
+          crossings_.push_back(e->x0 + (y - e->y0) * (e->x1 - e->x0) / (e->y1 - e->y0));
+        std::sort(crossings_.begin(), crossings_.end());
+
+        for (std::size_t i = 0; i + 1 < crossings_.size(); i += 2) {
+          auto x0 = std::max(0.0, crossings_[i]);
+          auto x1 = std::min(double(raster_.width), crossings_[i + 1]);
+          if (x0 >= x1)
+            continue;
+          if (!options_.antialias) {
+            // Cells whose centers lie in [x0, x1).
+            auto first = std::size_t(std::ceil(x0 - 0.5));
+            auto end = std::size_t(std::max(0.0, std::ceil(x1 - 0.5)));
+            for (auto c = first; c < end && c < raster_.width; c++)
+              apply(c, row, 1);
+            continue;
+          }
+          auto first = std::size_t(x0), last = std::min(raster_.width - 1, std::size_t(x1));
+          for (auto c = first; c <= last; c++) {
+            auto covered = std::min(x1, double(c + 1)) - std::max(x0, double(c));
+            if (covered > 0)
+              coverage_[c] += covered / samples;
+          }
+          touched_min = std::min(touched_min, first);
+          touched_max = std::max(touched_max, last);
+        }
+      }
+
+      for (auto c = touched_min; c <= touched_max && c < raster_.width; c++) {
+        if (coverage_[c] > 0)
+          apply(c, row, std::min(1.0, coverage_[c]));
+        coverage_[c] = 0;
+      }
+    }
+  }
+
+  raster &raster_;
+  const raster_options &options_;
+  std::size_t row0_, row1_;
+  std::vector<std::uint32_t> stamps_;
+  std::vector<double> coverage_;
+  std::vector<const raster_shape::edge *> active_;
+  std::vector<double> crossings_;
+  double weight_ = 1;
+  std::uint32_t stamp_ = 0;
+};
+
+}  // namespace detail
+
+// Burns every feature of a collection into a raster with an edge-table
+// scanline fill for polygons and a grid traversal for lines. Features are
+// prepared in parallel, then each thread burns all features into its own
+// band of rows, so no cell is shared between threads.
+template<typename T>
+raster rasterize(const feature_collection<T> &features, const raster_options &options) {
+  if (options.width == 0 || options.height == 0
+      || !(options.extent.max_corner().x() > options.extent.min_corner().x())
+      || !(options.extent.max_corner().y() > options.extent.min_corner().y()))
+    throw std::invalid_argument("raster must have a size and a non-empty extent");
+
+  raster result;
+  result.width = options.width;
+  result.height = options.height;
+  result.extent = options.extent;
+  // MAX cells start below any value so that negative values win; the
+  // cells left untouched are reset to 0 once their band is burnt.
+  const auto empty = options.mode == raster_mode::MAX
+      ? -std::numeric_limits<double>::infinity() : 0.0;
+  result.values.assign(options.width * options.height, empty);
+
+  std::vector<detail::raster_shape> shapes(features.size());
+  parallel_for(features.size(), options.threads, [&](std::size_t begin, std::size_t end) {
+    for (auto i = begin; i < end; i++) {
+      auto &shape = shapes[i];
+      if (options.mode != raster_mode::COUNT) {
+        auto it = features[i].properties.find(options.property);
+        shape.skip = it == features[i].properties.end()
+            || !boost::apply_visitor(detail::number_visitor(shape.weight), it->second);
+        if (shape.skip)
+          continue;
+      }
+      detail::shape_builder<T> builder(options, shape);
+      builder.add(features[i].geometry);
+      builder.finish();
+    }
+  });
+
+  parallel_for(options.height, options.threads, [&](std::size_t begin, std::size_t end) {
+    detail::band_burner burner(result, options, begin, end);
+    for (std::size_t i = 0; i < shapes.size(); i++)
+      burner.burn(shapes[i], std::uint32_t(i + 1));
+    if (options.mode == raster_mode::MAX) {
+      for (auto i = begin * result.width; i < end * result.width; i++) {
+        if (result.values[i] == empty)
+          result.values[i] = 0;
+      }
+    }
+  });
+  return result;
+}
+
+NS_GEOMETRY_END
+NS_GAGO_END
+
+#endif //  GEOJSON_CPP_GAGO_GEOMETRY_RASTERIZE_H_
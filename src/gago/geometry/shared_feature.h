@@ -0,0 +1,167 @@
+//
+// Copyright (c) 2018 ChuiZi (wuqinchun at gagogroup.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef GEOJSON_CPP_GAGO_GEOMETRY_SHARED_FEATURE_H_
+#define GEOJSON_CPP_GAGO_GEOMETRY_SHARED_FEATURE_H_
+
+#include <atomic>
+#include <vector>
+#include <utility>
+
+#include <gago/macros.h>
+#include <gago/geometry/geometry.h>
+#include <gago/geometry/feature.h>
+
+NS_GAGO_BEGIN
+NS_GEOMETRY_BEGIN
+
+// Reference-counted handle to an immutable value. Copies share the value;
+// mutate() gives write access, first cloning the value if any other
+// handle shares it (copy on write). Handles may be copied and read from
+// any thread; a handle must not be mutated while another thread uses the
+// same handle object.
+//
+// The count is kept here rather than in a shared_ptr so that mutate() can
+// test uniqueness with an acquire load: releasing a handle is a release
+// operation, so reads made through it happen before any write in place.
+template<typename V>
+class shared_value {
+ public:
+  using value_type = V;
+
+  shared_value(const V &v) : block_(new block(v)) {}
+
+  shared_value(V &&v) : block_(new block(std::move(v))) {}
+
+  shared_value(const shared_value &other) : block_(other.block_) {
+    block_->refs.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  shared_value(shared_value &&other) noexcept : block_(other.block_) {
+    other.block_ = nullptr;
+  }
+
+  shared_value &operator=(shared_value other) noexcept {
+    std::swap(block_, other.block_);
+    return *this;
+  }
+
+  ~shared_value() {
+    release();
+  }
+
+  const V &operator*() const {
+    return block_->value;
+  }
+
+  const V *operator->() const {
+    return &block_->value;
+  }
+
+  const V &get() const {
+    return block_->value;
+  }
+
+  V &mutate() {
+    if (block_->refs.load(std::memory_order_acquire) != 1) {
+      auto copy = new block(block_->value);
+      release();
+      block_ = copy;
+    }
+    return block_->value;
+  }
+
+  long use_count() const {
+    return block_ ? block_->refs.load(std::memory_order_relaxed) : 0;
+  }
+
+  bool shares_with(const shared_value &other) const {
+    return block_ == other.block_;
+  }
+
+ private:
+  struct block {
+    explicit block(const V &v) : value(v) {}
+    explicit block(V &&v) : value(std::move(v)) {}
+
+    std::atomic<long> refs{1};
+    V value;
+  };
+
+  void release() {
+    if (block_ && block_->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      delete block_;
+  }
+
+  block *block_;
+};
+
+template<typename V>
+bool operator==(const shared_value<V> &lhs, const shared_value<V> &rhs) {
+  return lhs.shares_with(rhs) || *lhs == *rhs;
+}
+
+template<typename V>
+bool operator!=(const shared_value<V> &lhs, const shared_value<V> &rhs) {
+  return !(lhs == rhs);
+}
+
+template<class T>
+using shared_geometry = shared_value<geometry<T>>;
+
+template<class T>
+using shared_feature = shared_value<feature<T>>;
+
+// A feature collection whose copies, and copies of whose features, share
+// the features instead of deep copying them.
+template<
+    class T,
+    template<typename...> class Container = std::vector
+>
+struct shared_feature_collection : Container<shared_feature<T>> {
+  using feature_type = shared_feature<T>;
+  using container_type = Container<feature_type>;
+  using container_type::container_type;
+
+  shared_feature_collection() = default;
+
+  // Takes over the features of a plain collection without copying them.
+  explicit shared_feature_collection(feature_collection<T, Container> &&features) {
+    this->reserve(features.size());
+    for (auto &f : features)
+      this->emplace_back(std::move(f));
+  }
+
+  // Deep copy into a plain collection.
+  feature_collection<T, Container> to_collection() const {
+    feature_collection<T, Container> features;
+    features.reserve(this->size());
+    for (const auto &f : *this)
+      features.push_back(*f);
+    return features;
+  }
+};
+
+NS_GEOMETRY_END
+NS_GAGO_END
+
+#endif //  GEOJSON_CPP_GAGO_GEOMETRY_SHARED_FEATURE_H_
@@ -0,0 +1,225 @@
+//
+// Copyright (c) 2018 ChuiZi (wuqinchun at gagogroup.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef GEOJSON_CPP_GAGO_GEOMETRY_SIMPLIFY_H_
+#define GEOJSON_CPP_GAGO_GEOMETRY_SIMPLIFY_H_
+
+#include <queue>
+#include <vector>
+#include <cstddef>
+#include <utility>
+#include <functional>
+
+#include <gago/macros.h>
+
+NS_GAGO_BEGIN
+NS_GEOMETRY_BEGIN
+
+enum class simplify_method {
+  DOUGLAS_PEUCKER = 0,
+  VISVALINGAM
+};
+
+namespace detail {
+
+template<typename Point>
+double segment_distance_sq(const Point &p, const Point &a, const Point &b) {
+  double x = a.x(), y = a.y();
+  double dx = double(b.x()) - x, dy = double(b.y()) - y;
+
+  if (dx != 0 || dy != 0) {
+    double t = ((p.x() - x) * dx + (p.y() - y) * dy) / (dx * dx + dy * dy);
+    if (t > 1) {
+      x = b.x();
+      y = b.y();
+    } else if (t > 0) {
+      x += dx * t;
+      y += dy * t;
+    }
+  }
+
+  dx = p.x() - x;
+  dy = p.y() - y;
+  return dx * dx + dy * dy;
+}
+
+template<typename Point>
+double triangle_area(const Point &a, const Point &b, const Point &c) {
+  double area = (double(b.x()) - a.x()) * (double(c.y()) - a.y())
+      - (double(c.x()) - a.x()) * (double(b.y()) - a.y());
+  return area < 0 ? -area / 2 : area / 2;
+}
+
+template<typename Range>
+std::pair<std::size_t, double> farthest(const Range &points,
+                                        std::size_t first,
+                                        std::size_t last) {
+  std::pair<std::size_t, double> result{first, 0};
+  for (auto i = first + 1; i < last; i++) {
+    auto d = segment_distance_sq(points[i], points[first], points[last]);
+    if (d > result.second)
+      result = {i, d};
+  }
+  return result;
+}
+
+// Walks the segments depth first, left to right, so kept points are
+// emitted in order and never overwrite a point that is still to be read.
+template<typename Range>
+std::size_t douglas_peucker(Range &points, double sq_tolerance, bool closed) {
+  struct segment {
+    std::size_t first;
+    std::size_t last;
+    bool force;
+  };
+
+  auto last = points.size() - 1;
+  std::vector<segment> stack;
+
+  if (closed) {
+    // The ring starts and ends on the same point, so this is the point
+    // farthest from the start.
+    auto split = farthest(points, 0, last).first;
+    if (split == 0)
+      return points.size();
+
+    // A closed ring needs at least four points, so one interior point of
+    // the halves is always kept even if it is within tolerance. Only a
+    // half with an interior point can be forced; one of them has one as
+    // the ring has at least five points.
+    auto left = farthest(points, 0, split);
+    auto right = farthest(points, split, last);
+    bool force = left.second <= sq_tolerance && right.second <= sq_tolerance;
+    bool force_right = last - split > 1 && (split == 1 || right.second > left.second);
+    stack.push_back({split, last, force && force_right});
+    stack.push_back({0, split, force && !force_right});
+  } else {
+    stack.push_back({0, last, false});
+  }
+
+  std::size_t size = 1;
+  while (!stack.empty()) {
+    auto s = stack.back();
+    stack.pop_back();
+
+    auto max = farthest(points, s.first, s.last);
+    // Every interior point of a degenerate half lies on its chord.
+    if (s.force && max.first == s.first)
+      max.first = (s.first + s.last) / 2;
+    if (max.first != s.first && (s.force || max.second > sq_tolerance)) {
+      stack.push_back({max.first, s.last, false});
+      stack.push_back({s.first, max.first, false});
+    } else {
+      points[size++] = points[s.last];
+    }
+  }
+  return size;
+}
+
+template<typename Range>
+std::size_t visvalingam(Range &points, double min_area, bool closed) {
+  auto n = points.size();
+  auto min_size = std::size_t(closed ? 4 : 2);
+
+  std::vector<std::size_t> prev(n), next(n);
+  std::vector<double> area(n, 0);
+  for (std::size_t i = 0; i < n; i++) {
+    prev[i] = i - 1;
+    next[i] = i + 1;
+  }
+
+  using entry = std::pair<double, std::size_t>;
+  std::priority_queue<entry, std::vector<entry>, std::greater<entry>> queue;
+  for (std::size_t i = 1; i + 1 < n; i++) {
+    area[i] = triangle_area(points[i - 1], points[i], points[i + 1]);
+    queue.push({area[i], i});
+  }
+
+  auto size = n;
+  double max_area = 0;
+  while (!queue.empty() && size > min_size) {
+    auto top = queue.top();
+    queue.pop();
+
+    auto i = top.second;
+    if (next[i] == n || top.first != area[i])
+      continue;
+    if (top.first >= min_area)
+      break;
+
+    // Effective areas never decrease, so a point is not dropped before
+    // the neighbour whose removal exposed it.
+    if (top.first > max_area)
+      max_area = top.first;
+
+    auto p = prev[i], q = next[i];
+    next[p] = q;
+    prev[q] = p;
+    next[i] = n;
+    size--;
+
+    if (p > 0) {
+      auto a = triangle_area(points[prev[p]], points[p], points[q]);
+      area[p] = a < max_area ? max_area : a;
+      queue.push({area[p], p});
+    }
+    if (q + 1 < n) {
+      auto a = triangle_area(points[p], points[q], points[next[q]]);
+      area[q] = a < max_area ? max_area : a;
+      queue.push({area[q], q});
+    }
+  }
+
+  std::size_t out = 0;
+  for (std::size_t i = 0; i < n; i = next[i])
+    points[out++] = points[i];
+  return out;
+}
+
+}  // namespace detail
+
+// Simplifies a linestring or ring in place, reusing its storage. Rings
+// (`closed`) keep their closing point and never drop below four points;
+// open lines keep both end points. For Douglas-Peucker `tolerance` is a
+// distance; for Visvalingam points whose effective area is below
+// `tolerance * tolerance` are removed.
+template<typename Range>
+void simplify(Range &points,
+              double tolerance,
+              simplify_method method = simplify_method::DOUGLAS_PEUCKER,
+              bool closed = false) {
+  if (tolerance <= 0 || points.size() < (closed ? std::size_t(5) : std::size_t(3)))
+    return;
+
+  std::size_t size;
+  if (method == simplify_method::VISVALINGAM)
+    size = detail::visvalingam(points, tolerance * tolerance, closed);
+  else
+    size = detail::douglas_peucker(points, tolerance * tolerance, closed);
+
+  points.resize(size, points.front());
+}
+
+NS_GEOMETRY_END
+NS_GAGO_END
+
+#endif //  GEOJSON_CPP_GAGO_GEOMETRY_SIMPLIFY_H_
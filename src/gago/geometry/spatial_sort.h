@@ -0,0 +1,210 @@
+//
+// Copyright (c) 2018 ChuiZi (wuqinchun at gagogroup.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef GEOJSON_CPP_GAGO_GEOMETRY_SPATIAL_SORT_H_
+#define GEOJSON_CPP_GAGO_GEOMETRY_SPATIAL_SORT_H_
+
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+
+#include <gago/macros.h>
+#include <gago/parallel.h>
+#include <gago/geometry/box.h>
+#include <gago/geometry/geometry.h>
+#include <gago/geometry/feature.h>
+
+NS_GAGO_BEGIN
+NS_GEOMETRY_BEGIN
+
+enum class space_filling_curve {
+  HILBERT = 0,
+  Z_ORDER
+};
+
+// Distance along the Hilbert curve filling a 2^32 x 2^32 grid.
+inline std::uint64_t hilbert_key(std::uint32_t x, std::uint32_t y) {
+  std::uint64_t key = 0;
+  for (std::uint32_t s = std::uint32_t(1) << 31; s > 0; s >>= 1) {
+    std::uint32_t rx = (x & s) ? 1 : 0;
+    std::uint32_t ry = (y & s) ? 1 : 0;
+    key += std::uint64_t(s) * s * ((3 * rx) ^ ry);
+    if (ry == 0) {
+      if (rx == 1) {
+        x = ~x;
+        y = ~y;
+      }
+      std::swap(x, y);
+    }
+  }
+  return key;
+}
+
+// Morton code: the bits of x and y interleaved, x in the even bits.
+inline std::uint64_t z_order_key(std::uint32_t x, std::uint32_t y) {
+  auto spread = [](std::uint64_t v) {
+    v = (v | (v << 16)) & 0x0000FFFF0000FFFFull;
+    v = (v | (v << 8)) & 0x00FF00FF00FF00FFull;
+    v = (v | (v << 4)) & 0x0F0F0F0F0F0F0F0Full;
+    v = (v | (v << 2)) & 0x3333333333333333ull;
+    v = (v | (v << 1)) & 0x5555555555555555ull;
+    return v;
+  };
+  return spread(x) | (spread(y) << 1);
+}
+
+namespace detail {
+
+template<typename T>
+bounds<double> feature_bounds(const feature<T> &f) {
+  bounds<double> b;
+  if (f.bbox) {
+    b.expand(double(f.bbox->min_corner().x()), double(f.bbox->min_corner().y()));
+    b.expand(double(f.bbox->max_corner().x()), double(f.bbox->max_corner().y()));
+  } else {
+    gago::geometry::for_each_point(f.geometry, [&b](const point<T> &p) {
+      b.expand(double(p.x()), double(p.y()));
+    });
+  }
+  return b;
+}
+
+inline std::uint32_t grid_coordinate(double v, double min, double scale) {
+  auto scaled = (v - min) * scale;
+  if (!(scaled > 0))
+    return 0;
+  if (scaled >= 4294967295.0)
+    return 0xFFFFFFFFu;
+  return std::uint32_t(scaled);
+}
+
+}  // namespace detail
+
+// Returns the permutation that orders the features by the position of
+// their envelope centers along a space filling curve laid over the extent
+// of all centers; features with empty geometries sort first. Uses cached
+// feature bounding boxes when present. Ties keep their original order.
+template<typename T>
+std::vector<std::size_t> spatial_order(const feature_collection<T> &features,
+                                       space_filling_curve curve = space_filling_curve::HILBERT,
+                                       std::size_t threads = 0) {
+  auto count = features.size();
+  std::vector<point<double>> centers(count);
+  std::vector<char> empty(count, 0);
+  // Each chunk owns one extent and one sorted run.
+  auto chunks = chunk_count(count, threads);
+  std::vector<bounds<double>> extents(chunks);
+  parallel_for_chunks(count, threads, [&](std::size_t chunk, std::size_t begin, std::size_t end) {
+    auto &extent = extents[chunk];
+    for (auto i = begin; i < end; i++) {
+      auto b = detail::feature_bounds(features[i]);
+      if (b.empty()) {
+        empty[i] = 1;
+        continue;
+      }
+      centers[i] = point<double>((b.min_x + b.max_x) / 2, (b.min_y + b.max_y) / 2);
+      extent.expand(centers[i]);
+    }
+  });
+
+  bounds<double> extent;
+  for (const auto &e : extents)
+    extent.expand(e);
+
+  auto width = extent.max_x - extent.min_x;
+  auto height = extent.max_y - extent.min_y;
+  auto scale_x = width > 0 ? 4294967295.0 / width : 0.0;
+  auto scale_y = height > 0 ? 4294967295.0 / height : 0.0;
+
+  using entry = std::pair<std::uint64_t, std::size_t>;
+  std::vector<entry> keys(count);
+  std::vector<std::size_t> run_ends(chunks, 0);
+  parallel_for_chunks(count, threads, [&](std::size_t chunk, std::size_t begin, std::size_t end) {
+    for (auto i = begin; i < end; i++) {
+      if (empty[i]) {
+        keys[i] = entry(0, i);
+        continue;
+      }
+      auto x = detail::grid_coordinate(centers[i].x(), extent.min_x, scale_x);
+      auto y = detail::grid_coordinate(centers[i].y(), extent.min_y, scale_y);
+      auto key = curve == space_filling_curve::HILBERT ? hilbert_key(x, y) : z_order_key(x, y);
+      // Non-empty features start at key 1 so empty ones sort first.
+      keys[i] = entry(key == ~std::uint64_t(0) ? key : key + 1, i);
+    }
+    std::sort(keys.begin() + begin, keys.begin() + end);
+    run_ends[chunk] = end;
+  });
+
+  // Merge the runs sorted by each chunk, pairwise. Chunks that got no
+  // items leave empty runs.
+  std::vector<std::size_t> edges{0};
+  for (auto end : run_ends)
+    edges.push_back(std::max(edges.back(), end));
+  while (edges.size() > 2) {
+    std::vector<std::size_t> merged{0};
+    for (std::size_t i = 2; i < edges.size(); i += 2) {
+      std::inplace_merge(keys.begin() + edges[i - 2], keys.begin() + edges[i - 1],
+                         keys.begin() + edges[i]);
+      merged.push_back(edges[i]);
+    }
+    if (edges.size() % 2 == 0)
+      merged.push_back(edges.back());
+    edges.swap(merged);
+  }
+
+  std::vector<std::size_t> order(count);
+  for (std::size_t i = 0; i < count; i++)
+    order[i] = keys[i].second;
+  return order;
+}
+
+// Reorders the features in place so that spatially close features are
+// close in memory, see `spatial_order`. Features are moved, not copied.
+template<typename T>
+void spatial_sort(feature_collection<T> &features,
+                  space_filling_curve curve = space_filling_curve::HILBERT,
+                  std::size_t threads = 0) {
+  auto order = spatial_order(features, curve, threads);
+
+  // Follow each cycle of the permutation, moving every feature once.
+  for (std::size_t start = 0; start < order.size(); start++) {
+    if (order[start] == start)
+      continue;
+    auto held = std::move(features[start]);
+    auto i = start;
+    while (order[i] != start) {
+      auto next = order[i];
+      features[i] = std::move(features[next]);
+      order[i] = i;
+      i = next;
+    }
+    features[i] = std::move(held);
+    order[i] = i;
+  }
+}
+
+NS_GEOMETRY_END
+NS_GAGO_END
+
+#endif //  GEOJSON_CPP_GAGO_GEOMETRY_SPATIAL_SORT_H_
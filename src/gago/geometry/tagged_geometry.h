@@ -0,0 +1,214 @@
+//
+// Copyright (c) 2018 ChuiZi (wuqinchun at gagogroup.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef GEOJSON_CPP_GAGO_GEOMETRY_TAGGED_GEOMETRY_H_
+#define GEOJSON_CPP_GAGO_GEOMETRY_TAGGED_GEOMETRY_H_
+
+#include <new>
+#include <cassert>
+#include <utility>
+#include <type_traits>
+
+#include <gago/macros.h>
+#include <gago/geometry/geometry.h>
+
+NS_GAGO_BEGIN
+NS_GEOMETRY_BEGIN
+
+// A geometry stored as a plain tag plus inline storage. Unlike `geometry`
+// it never falls back to heap backups on assignment, and `visit` resolves
+// the held type with a single switch that the compiler can inline into
+// each case. Converts from and to `geometry`.
+template<typename T>
+class tagged_geometry {
+ public:
+  tagged_geometry() : type_(geometry_type::POINT) {
+    construct(point<T>());
+  }
+
+  tagged_geometry(point<T> g) : type_(geometry_type::POINT) {
+    construct(std::move(g));
+  }
+
+  tagged_geometry(multi_point<T> g) : type_(geometry_type::MULTIPOINT) {
+    construct(std::move(g));
+  }
+
+  tagged_geometry(linestring<T> g) : type_(geometry_type::LINESTRING) {
+    construct(std::move(g));
+  }
+
+  tagged_geometry(multi_linestring<T> g) : type_(geometry_type::MULTILINESTRING) {
+    construct(std::move(g));
+  }
+
+  tagged_geometry(polygon<T> g) : type_(geometry_type::POLYGON) {
+    construct(std::move(g));
+  }
+
+  tagged_geometry(multi_polygon<T> g) : type_(geometry_type::MULTIPOLYGON) {
+    construct(std::move(g));
+  }
+
+  tagged_geometry(const geometry<T> &g) : type_(type_of(g)) {
+    gago::geometry::visit(g, [this](const auto &held) { this->construct(held); });
+  }
+
+  tagged_geometry(geometry<T> &&g) : type_(type_of(g)) {
+    gago::geometry::visit(g, [this](auto &held) { this->construct(std::move(held)); });
+  }
+
+  tagged_geometry(const tagged_geometry &other) : type_(other.type_) {
+    other.visit([this](const auto &held) { this->construct(held); });
+  }
+
+  tagged_geometry(tagged_geometry &&other) noexcept : type_(other.type_) {
+    other.visit([this](auto &held) { this->construct(std::move(held)); });
+  }
+
+  tagged_geometry &operator=(const tagged_geometry &other) {
+    if (this != &other) {
+      tagged_geometry copy(other);
+      *this = std::move(copy);
+    }
+    return *this;
+  }
+
+  tagged_geometry &operator=(tagged_geometry &&other) noexcept {
+    if (this != &other) {
+      destroy();
+      type_ = other.type_;
+      other.visit([this](auto &held) { this->construct(std::move(held)); });
+    }
+    return *this;
+  }
+
+  ~tagged_geometry() {
+    destroy();
+  }
+
+  geometry_type type() const {
+    return type_;
+  }
+
+  template<geometry_type Type>
+  typename geometry_of<Type, T>::type &get() {
+    assert(type_ == Type);
+    return *reinterpret_cast<typename geometry_of<Type, T>::type *>(&storage_);
+  }
+
+  template<geometry_type Type>
+  const typename geometry_of<Type, T>::type &get() const {
+    assert(type_ == Type);
+    return *reinterpret_cast<const typename geometry_of<Type, T>::type *>(&storage_);
+  }
+
+  template<typename F>
+  auto visit(F &&f) -> decltype(f(std::declval<point<T> &>())) {
+    return dispatch(*this, f);
+  }
+
+  template<typename F>
+  auto visit(F &&f) const -> decltype(f(std::declval<const point<T> &>())) {
+    return dispatch(*this, f);
+  }
+
+  geometry<T> to_geometry() const & {
+    return visit([](const auto &held) { return geometry<T>(held); });
+  }
+
+  geometry<T> to_geometry() && {
+    return visit([](auto &held) { return geometry<T>(std::move(held)); });
+  }
+
+ private:
+  template<typename Self, typename F>
+  static auto dispatch(Self &self, F &f) -> decltype(f(self.template get<geometry_type::POINT>())) {
+    switch (self.type_) {
+      case geometry_type::POINT:
+        return f(self.template get<geometry_type::POINT>());
+      case geometry_type::MULTIPOINT:
+        return f(self.template get<geometry_type::MULTIPOINT>());
+      case geometry_type::LINESTRING:
+        return f(self.template get<geometry_type::LINESTRING>());
+      case geometry_type::MULTILINESTRING:
+        return f(self.template get<geometry_type::MULTILINESTRING>());
+      case geometry_type::POLYGON:
+        return f(self.template get<geometry_type::POLYGON>());
+      default:
+        assert(self.type_ == geometry_type::MULTIPOLYGON);
+        return f(self.template get<geometry_type::MULTIPOLYGON>());
+    }
+  }
+
+  template<typename Geometry>
+  void construct(Geometry &&g) {
+    using type = typename std::decay<Geometry>::type;
+    new(&storage_) type(std::forward<Geometry>(g));
+  }
+
+  void destroy() {
+    visit([](auto &held) {
+      using type = typename std::decay<decltype(held)>::type;
+      held.~type();
+    });
+  }
+
+  typename std::aligned_union<0,
+                              point<T>,
+                              multi_point<T>,
+                              linestring<T>,
+                              multi_linestring<T>,
+                              polygon<T>,
+                              multi_polygon<T>>::type storage_;
+  geometry_type type_;
+};
+
+template<typename T>
+geometry_type type_of(const tagged_geometry<T> &g) {
+  return g.type();
+}
+
+template<typename T, typename F>
+auto visit(const tagged_geometry<T> &g, F &&f) -> decltype(g.visit(f)) {
+  return g.visit(f);
+}
+
+template<typename T, typename F>
+auto visit(tagged_geometry<T> &g, F &&f) -> decltype(g.visit(f)) {
+  return g.visit(f);
+}
+
+template<typename T, typename F>
+void for_each_point(const tagged_geometry<T> &g, F &&f) {
+  g.visit(detail::point_visitor<F>{f});
+}
+
+template<typename T, typename F>
+void for_each_point(tagged_geometry<T> &g, F &&f) {
+  g.visit(detail::point_visitor<F>{f});
+}
+
+NS_GEOMETRY_END
+NS_GAGO_END
+
+#endif //  GEOJSON_CPP_GAGO_GEOMETRY_TAGGED_GEOMETRY_H_
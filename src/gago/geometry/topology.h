@@ -0,0 +1,399 @@
+//
+// Copyright (c) 2018 ChuiZi (wuqinchun at gagogroup.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef GEOJSON_CPP_GAGO_GEOMETRY_TOPOLOGY_H_
+#define GEOJSON_CPP_GAGO_GEOMETRY_TOPOLOGY_H_
+
+#include <cmath>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+#include <experimental/optional>
+
+#include <boost/variant.hpp>
+
+#include <gago/macros.h>
+#include <gago/geometry/box.h>
+#include <gago/geometry/geometry.h>
+#include <gago/geometry/value.h>
+#include <gago/geometry/feature.h>
+#include <gago/geometry/simplify.h>
+
+NS_GAGO_BEGIN
+NS_GEOMETRY_BEGIN
+
+// Polygonal features encoded as rings of shared arcs, as in TopoJSON.
+// Coordinates are quantized onto an integer grid; every border shared by
+// two rings is stored once, and rings refer to arcs by index, with ~i
+// meaning arc i walked backwards.
+struct topology {
+  using position = point<std::int32_t>;
+  using arc = linestring<std::int32_t>;
+  // Arc references making up one closed ring.
+  using ring = std::vector<std::int32_t>;
+  // Outer ring first, then holes.
+  using polygon = std::vector<ring>;
+
+  struct object {
+    geometry_type type;
+    std::vector<polygon> polygons;
+    property_map properties;
+    std::experimental::optional<identifier> id;
+  };
+
+  // Maps grid positions back: x = translate_x + qx * scale_x.
+  double scale_x = 1;
+  double scale_y = 1;
+  double translate_x = 0;
+  double translate_y = 0;
+
+  std::vector<arc> arcs;
+  std::vector<object> objects;
+
+  point<double> position_of(const position &p) const {
+    return point<double>(translate_x + p.x() * scale_x, translate_y + p.y() * scale_y);
+  }
+
+  std::size_t point_count() const {
+    std::size_t count = 0;
+    for (const auto &a : arcs)
+      count += a.size();
+    return count;
+  }
+};
+
+namespace detail {
+
+class topology_builder {
+ public:
+  using position = topology::position;
+
+  explicit topology_builder(topology &topo) : topo_(topo) {}
+
+  template<typename T>
+  void quantize(const polygon<T> &p, topology::object &object,
+                double kx, double ky) {
+    object.polygons.emplace_back();
+    add_ring(p.outer(), kx, ky);
+    for (const auto &inner : p.inners())
+      add_ring(inner, kx, ky);
+    shapes_.push_back(1 + p.inners().size());
+  }
+
+  // Finds the junctions, cuts every ring into arcs and fills in the ring
+  // references of the objects, in the order the rings were added.
+  void build() {
+    for (const auto &r : rings_)
+      find_junctions(r);
+
+    std::size_t next = 0, shape = 0;
+    for (auto &object : topo_.objects) {
+      for (auto &p : object.polygons) {
+        p.resize(shapes_[shape++]);
+        for (auto &r : p)
+          r = cut(rings_[next++]);
+      }
+    }
+  }
+
+ private:
+  struct neighbours {
+    std::uint64_t a, b;
+    bool junction;
+  };
+
+  static std::uint64_t key(const position &p) {
+    return (std::uint64_t(std::uint32_t(p.x())) << 32) | std::uint32_t(p.y());
+  }
+
+  static bool less(const position &a, const position &b) {
+    return a.x() < b.x() || (a.x() == b.x() && a.y() < b.y());
+  }
+
+  static bool same(const position &a, const position &b) {
+    return a.x() == b.x() && a.y() == b.y();
+  }
+
+  template<typename Ring>
+  void add_ring(const Ring &input, double kx, double ky) {
+    std::vector<position> ring;
+    ring.reserve(input.size() + 1);
+    for (const auto &p : input) {
+      position q(std::int32_t(std::lround((p.x() - topo_.translate_x) * kx)),
+                 std::int32_t(std::lround((p.y() - topo_.translate_y) * ky)));
+      if (ring.empty() || !same(ring.back(), q))
+        ring.push_back(q);
+    }
+    if (!ring.empty() && !same(ring.front(), ring.back()))
+      ring.push_back(ring.front());
+    rings_.push_back(std::move(ring));
+  }
+
+  // A point is a junction when rings pass through it with different
+  // neighbours, i.e. where a shared border starts or ends.
+  void find_junctions(const std::vector<position> &ring) {
+    if (ring.size() < 4)
+      return;
+    auto n = ring.size() - 1;
+    for (std::size_t i = 0; i < n; i++) {
+      auto prev = key(ring[i == 0 ? n - 1 : i - 1]);
+      auto next = key(ring[i + 1]);
+      if (prev > next)
+        std::swap(prev, next);
+
+      auto it = junctions_.find(key(ring[i]));
+      if (it == junctions_.end())
+        junctions_.emplace(key(ring[i]), neighbours{prev, next, false});
+      else if (it->second.a != prev || it->second.b != next)
+        it->second.junction = true;
+    }
+  }
+
+  bool is_junction(const position &p) const {
+    auto it = junctions_.find(key(p));
+    return it != junctions_.end() && it->second.junction;
+  }
+
+  topology::ring cut(const std::vector<position> &ring) {
+    topology::ring refs;
+    if (ring.size() < 4) {
+      refs.push_back(add_arc(ring.begin(), ring.end()));
+      return refs;
+    }
+
+    auto n = ring.size() - 1;
+    std::size_t start = n;
+    for (std::size_t i = 0; i < n && start == n; i++) {
+      if (is_junction(ring[i]))
+        start = i;
+    }
+
+    // Walk the ring from its first junction, or from its smallest point
+    // when it shares no border, so that equal rings give equal arcs.
+    if (start == n) {
+      start = 0;
+      for (std::size_t i = 1; i < n; i++) {
+        if (less(ring[i], ring[start]))
+          start = i;
+      }
+    }
+
+    std::vector<position> rotated;
+    rotated.reserve(ring.size());
+    for (std::size_t i = 0; i <= n; i++)
+      rotated.push_back(ring[(start + i) % n]);
+
+    std::size_t from = 0;
+    for (std::size_t i = 1; i <= n; i++) {
+      if (i == n || is_junction(rotated[i])) {
+        refs.push_back(add_arc(rotated.begin() + from, rotated.begin() + i + 1));
+        from = i;
+      }
+    }
+    return refs;
+  }
+
+  // Stores the arc unless it, or its reverse, is already stored, and
+  // returns the reference. Arcs are stored in their lexicographically
+  // smaller direction.
+  template<typename It>
+  std::int32_t add_arc(It first, It last) {
+    topology::arc forward(first, last);
+    topology::arc backward(forward.rbegin(), forward.rend());
+    bool reversed = std::lexicographical_compare(backward.begin(), backward.end(),
+                                                 forward.begin(), forward.end(), less);
+    const auto &canonical = reversed ? backward : forward;
+
+    std::uint64_t hash = 14695981039346656037ull;
+    for (const auto &p : canonical)
+      hash = (hash ^ key(p)) * 1099511628211ull;
+
+    auto range = arcs_.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+      const auto &stored = topo_.arcs[it->second];
+      if (stored.size() == canonical.size()
+          && std::equal(stored.begin(), stored.end(), canonical.begin(), same))
+        return reversed ? ~it->second : it->second;
+    }
+
+    auto index = std::int32_t(topo_.arcs.size());
+    topo_.arcs.push_back(reversed ? std::move(backward) : std::move(forward));
+    arcs_.emplace(hash, index);
+    return reversed ? ~index : index;
+  }
+
+  topology &topo_;
+  std::vector<std::vector<position>> rings_;
+  std::vector<std::size_t> shapes_;
+  std::unordered_map<std::uint64_t, neighbours> junctions_;
+  std::unordered_multimap<std::uint64_t, std::int32_t> arcs_;
+};
+
+}  // namespace detail
+
+// Builds the shared-arc topology of a collection of Polygon and
+// MultiPolygon features, quantizing coordinates onto a grid of
+// `quantization` x `quantization` positions over their extent. Throws
+// std::invalid_argument for any other geometry type.
+template<typename T>
+topology build_topology(const feature_collection<T> &features,
+                        std::int32_t quantization = 1000000) {
+  if (quantization < 2)
+    throw std::invalid_argument("topology quantization must be at least 2");
+
+  bounds<double> extent;
+  for (const auto &f : features) {
+    auto type = type_of(f.geometry);
+    if (type != geometry_type::POLYGON && type != geometry_type::MULTIPOLYGON)
+      throw std::invalid_argument("topology only encodes Polygon and MultiPolygon features");
+    gago::geometry::for_each_point(f.geometry, [&extent](const point<T> &p) {
+      extent.expand(double(p.x()), double(p.y()));
+    });
+  }
+
+  topology topo;
+  if (!extent.empty()) {
+    auto width = extent.max_x - extent.min_x;
+    auto height = extent.max_y - extent.min_y;
+    topo.translate_x = extent.min_x;
+    topo.translate_y = extent.min_y;
+    topo.scale_x = width > 0 ? width / (quantization - 1) : 1;
+    topo.scale_y = height > 0 ? height / (quantization - 1) : 1;
+  }
+
+  detail::topology_builder builder(topo);
+  topo.objects.reserve(features.size());
+  for (const auto &f : features) {
+    topo.objects.push_back(topology::object{type_of(f.geometry), {}, f.properties, f.id});
+    auto &object = topo.objects.back();
+    if (object.type == geometry_type::POLYGON) {
+      builder.quantize(boost::get<polygon<T>>(f.geometry), object,
+                       1 / topo.scale_x, 1 / topo.scale_y);
+    } else {
+      for (const auto &p : boost::get<multi_polygon<T>>(f.geometry))
+        builder.quantize(p, object, 1 / topo.scale_x, 1 / topo.scale_y);
+    }
+  }
+  builder.build();
+  return topo;
+}
+
+// Rebuilds the features of a topology, in their original order.
+template<typename T = double>
+feature_collection<T> to_features(const topology &topo) {
+  auto ring_of = [&topo](const topology::ring &refs) {
+    typename polygon<T>::ring_type ring;
+    for (auto ref : refs) {
+      const auto &a = topo.arcs[ref < 0 ? ~ref : ref];
+      // Consecutive arcs share their end points.
+      bool skip = !ring.empty();
+      auto append = [&](const topology::position &q) {
+        if (skip) {
+          skip = false;
+          return;
+        }
+        auto p = topo.position_of(q);
+        ring.emplace_back(T(p.x()), T(p.y()));
+      };
+      if (ref < 0)
+        std::for_each(a.rbegin(), a.rend(), append);
+      else
+        std::for_each(a.begin(), a.end(), append);
+    }
+    return ring;
+  };
+
+  auto polygon_of = [&ring_of](const topology::polygon &rings) {
+    polygon<T> p;
+    if (!rings.empty())
+      p.outer() = ring_of(rings[0]);
+    for (std::size_t i = 1; i < rings.size(); i++)
+      p.inners().push_back(ring_of(rings[i]));
+    return p;
+  };
+
+  feature_collection<T> features;
+  features.reserve(topo.objects.size());
+  for (const auto &object : topo.objects) {
+    if (object.type == geometry_type::POLYGON) {
+      features.emplace_back(polygon_of(object.polygons.front()), object.properties, object.id);
+    } else {
+      multi_polygon<T> parts;
+      for (const auto &rings : object.polygons)
+        parts.push_back(polygon_of(rings));
+      features.emplace_back(std::move(parts), object.properties, object.id);
+    }
+  }
+  return features;
+}
+
+// Simplifies every arc of a topology. Arcs end at junctions, which are
+// always kept, so neighbouring rings stay joined along their borders.
+// `tolerance` is in the units of the original coordinates.
+inline void simplify(topology &topo,
+                     double tolerance,
+                     simplify_method method = simplify_method::DOUGLAS_PEUCKER) {
+  // A ring of two arcs would collapse to a, b, a if both lost all of their
+  // interior points, so its arcs keep at least their farthest one. Rings
+  // of one arc are closed, and rings of three or more stay valid.
+  std::vector<bool> keep_interior(topo.arcs.size(), false);
+  for (const auto &object : topo.objects) {
+    for (const auto &rings : object.polygons) {
+      for (const auto &refs : rings) {
+        if (refs.size() != 2)
+          continue;
+        for (auto ref : refs)
+          keep_interior[std::size_t(ref < 0 ? ~ref : ref)] = true;
+      }
+    }
+  }
+
+  auto grid_tolerance = tolerance / std::sqrt(topo.scale_x * topo.scale_y);
+  topology::arc original;
+  for (std::size_t i = 0; i < topo.arcs.size(); i++) {
+    auto &a = topo.arcs[i];
+    bool closed = a.size() > 1 && a.front().x() == a.back().x() && a.front().y() == a.back().y();
+    if (!keep_interior[i] || closed || a.size() < 3) {
+      simplify(a, grid_tolerance, method, closed);
+      continue;
+    }
+
+    original.assign(a.begin(), a.end());
+    simplify(a, grid_tolerance, method);
+    if (a.size() == 2) {
+      auto farthest = detail::farthest(original, 0, original.size() - 1).first;
+      // Every interior point lies on the chord.
+      if (farthest == 0)
+        farthest = original.size() / 2;
+      a.insert(a.begin() + 1, original[farthest]);
+    }
+  }
+}
+
+NS_GEOMETRY_END
+NS_GAGO_END
+
+#endif //  GEOJSON_CPP_GAGO_GEOMETRY_TOPOLOGY_H_
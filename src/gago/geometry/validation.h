@@ -0,0 +1,75 @@
+//
+// Copyright (c) 2018 ChuiZi (wuqinchun at gagogroup.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef GEOJSON_CPP_GAGO_GEOMETRY_VALIDATION_H_
+#define GEOJSON_CPP_GAGO_GEOMETRY_VALIDATION_H_
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+#include <boost/geometry/algorithms/is_valid.hpp>
+
+#include <gago/macros.h>
+#include <gago/parallel.h>
+#include <gago/geometry/geometry.h>
+#include <gago/geometry/feature.h>
+
+NS_GAGO_BEGIN
+NS_GEOMETRY_BEGIN
+
+struct invalid_feature {
+  std::size_t index;
+  std::string reason;
+};
+
+// Runs the full OGC validity check of boost::geometry::is_valid, including
+// self-intersections, over every feature on `threads` threads, and returns
+// the invalid ones in collection order. The check follows the clockwise
+// outer rings of the polygon model; convert with
+// ring_orientation::CLOCKWISE first to validate RFC 7946 input.
+template<typename T>
+std::vector<invalid_feature> find_invalid(const feature_collection<T> &features,
+                                          std::size_t threads = 0) {
+  std::vector<std::string> reasons(features.size());
+  parallel_for(features.size(), threads, [&](std::size_t begin, std::size_t end) {
+    for (auto i = begin; i < end; i++) {
+      visit(features[i].geometry, [&reasons, i](const auto &g) {
+        std::string message;
+        if (!boost::geometry::is_valid(g, message))
+          reasons[i] = std::move(message);
+      });
+    }
+  });
+
+  std::vector<invalid_feature> invalid;
+  for (std::size_t i = 0; i < reasons.size(); i++) {
+    if (!reasons[i].empty())
+      invalid.push_back(invalid_feature{i, std::move(reasons[i])});
+  }
+  return invalid;
+}
+
+NS_GEOMETRY_END
+NS_GAGO_END
+
+#endif //  GEOJSON_CPP_GAGO_GEOMETRY_VALIDATION_H_
@@ -0,0 +1,101 @@
+//
+// Copyright (c) 2018 ChuiZi (wuqinchun at gagogroup.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef GEOJSON_CPP_GAGO_PARALLEL_H_
+#define GEOJSON_CPP_GAGO_PARALLEL_H_
+
+#include <vector>
+#include <thread>
+#include <cstddef>
+#include <exception>
+
+#include <gago/macros.h>
+
+NS_GAGO_BEGIN
+
+// Number of worker threads to use when the caller asks for `threads`;
+// zero means one per hardware thread.
+inline std::size_t thread_count(std::size_t threads) {
+  if (threads == 0)
+    threads = std::thread::hardware_concurrency();
+  return threads == 0 ? 1 : threads;
+}
+
+// Number of chunks parallel_for splits `count` items into for `threads`
+// threads, so that callers can give each chunk its own slot.
+inline std::size_t chunk_count(std::size_t count, std::size_t threads) {
+  threads = thread_count(threads);
+  return threads > count ? count : threads;
+}
+
+// Calls f(chunk, begin, end) on contiguous chunks of [0, count), one chunk
+// per thread, where `chunk` is the index of the chunk, below
+// chunk_count(count, threads), in item order; the last chunk runs on the
+// calling thread. The first exception thrown by any chunk is rethrown
+// once all chunks have finished.
+template<typename F>
+void parallel_for_chunks(std::size_t count, std::size_t threads, F &&f) {
+  threads = chunk_count(count, threads);
+  if (threads <= 1) {
+    if (count > 0)
+      f(std::size_t(0), std::size_t(0), count);
+    return;
+  }
+
+  auto chunk = (count + threads - 1) / threads;
+  std::vector<std::exception_ptr> errors(threads);
+  std::vector<std::thread> workers;
+  workers.reserve(threads - 1);
+
+  auto run = [&](std::size_t i) {
+    auto begin = i * chunk;
+    auto end = begin + chunk < count ? begin + chunk : count;
+    try {
+      if (begin < end)
+        f(i, begin, end);
+    } catch (...) {
+      errors[i] = std::current_exception();
+    }
+  };
+
+  for (std::size_t i = 0; i + 1 < threads; i++)
+    workers.emplace_back(run, i);
+  run(threads - 1);
+
+  for (auto &worker : workers)
+    worker.join();
+  for (auto &e : errors)
+    if (e)
+      std::rethrow_exception(e);
+}
+
+// Calls f(begin, end) on the chunks of parallel_for_chunks.
+template<typename F>
+void parallel_for(std::size_t count, std::size_t threads, F &&f) {
+  parallel_for_chunks(count, threads, [&f](std::size_t, std::size_t begin, std::size_t end) {
+    f(begin, end);
+  });
+}
+
+NS_GAGO_END
+
+#endif //  GEOJSON_CPP_GAGO_PARALLEL_H_
@@ -0,0 +1,207 @@
+//
+// Copyright (c) 2018 ChuiZi (wuqinchun at gagogroup.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef GEOJSON_CPP_GAGO_SNAPSHOT_H_
+#define GEOJSON_CPP_GAGO_SNAPSHOT_H_
+
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cassert>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <stdexcept>
+
+#include <gago/macros.h>
+
+NS_GAGO_BEGIN
+
+// Publishes immutable versions of a value, e.g. a parsed feature
+// collection, to many reader threads. Readers take snapshots without locks
+// or reference count traffic: a snapshot announces the epoch it started in
+// and then loads the current version. publish() swaps in a new version and
+// retires the old one, which is deleted once no reader that might still
+// hold it is active. Writers serialize among themselves.
+//
+// Each reader thread registers once and holds at most one snapshot at a
+// time; snapshots and readers must not outlive the publisher.
+template<typename T>
+class snapshot_publisher {
+  struct version {
+    T value;
+    std::uint64_t retired_at = 0;
+
+    explicit version(T value_) : value(std::move(value_)) {}
+  };
+
+  struct slot {
+    // Epoch the reader's current snapshot started in, 0 while idle.
+    std::atomic<std::uint64_t> epoch{0};
+    std::atomic<bool> used{false};
+    // Keep each reader's slot on its own cache line.
+    char padding[64 - sizeof(std::atomic<std::uint64_t>) - sizeof(std::atomic<bool>)];
+  };
+
+ public:
+  class snapshot {
+   public:
+    snapshot(snapshot &&other) noexcept : value_(other.value_), slot_(other.slot_) {
+      other.slot_ = nullptr;
+    }
+
+    snapshot(const snapshot &) = delete;
+    snapshot &operator=(const snapshot &) = delete;
+    snapshot &operator=(snapshot &&) = delete;
+
+    ~snapshot() {
+      if (slot_)
+        slot_->epoch.store(0, std::memory_order_release);
+    }
+
+    const T &operator*() const {
+      return *value_;
+    }
+
+    const T *operator->() const {
+      return value_;
+    }
+
+    const T *get() const {
+      return value_;
+    }
+
+   private:
+    friend class snapshot_publisher;
+
+    snapshot(const T *value, slot *s) : value_(value), slot_(s) {}
+
+    const T *value_;
+    slot *slot_;
+  };
+
+  class reader {
+   public:
+    reader(reader &&other) noexcept : owner_(other.owner_), slot_(other.slot_) {
+      other.slot_ = nullptr;
+    }
+
+    reader(const reader &) = delete;
+    reader &operator=(const reader &) = delete;
+    reader &operator=(reader &&) = delete;
+
+    ~reader() {
+      if (slot_)
+        slot_->used.store(false, std::memory_order_release);
+    }
+
+    snapshot read() const {
+      assert(slot_->epoch.load(std::memory_order_relaxed) == 0);
+      slot_->epoch.store(owner_->epoch_.load());
+      return snapshot(&owner_->current_.load()->value, slot_);
+    }
+
+   private:
+    friend class snapshot_publisher;
+
+    reader(const snapshot_publisher *owner, slot *s) : owner_(owner), slot_(s) {}
+
+    const snapshot_publisher *owner_;
+    slot *slot_;
+  };
+
+  explicit snapshot_publisher(T initial, std::size_t max_readers = 64)
+      : current_(new version(std::move(initial))),
+        slots_(new slot[max_readers]),
+        slot_count_(max_readers) {}
+
+  snapshot_publisher(const snapshot_publisher &) = delete;
+  snapshot_publisher &operator=(const snapshot_publisher &) = delete;
+
+  ~snapshot_publisher() {
+    delete current_.load();
+    for (auto v : retired_)
+      delete v;
+  }
+
+  // Claims a reader slot; throws std::length_error when all are taken.
+  reader register_reader() {
+    for (std::size_t i = 0; i < slot_count_; i++) {
+      bool expected = false;
+      if (!slots_[i].used.load(std::memory_order_relaxed)
+          && slots_[i].used.compare_exchange_strong(expected, true))
+        return reader(this, &slots_[i]);
+    }
+    throw std::length_error("snapshot_publisher has no free reader slots");
+  }
+
+  // Makes `value` the version seen by new snapshots and reclaims whatever
+  // older versions no reader can see any more.
+  void publish(T value) {
+    auto next = new version(std::move(value));
+    std::lock_guard<std::mutex> lock(writer_);
+    auto previous = current_.exchange(next);
+    previous->retired_at = epoch_.fetch_add(1) + 1;
+    retired_.push_back(previous);
+    reclaim_locked();
+  }
+
+  // Deletes retired versions no reader can see; returns how many are left.
+  std::size_t reclaim() {
+    std::lock_guard<std::mutex> lock(writer_);
+    reclaim_locked();
+    return retired_.size();
+  }
+
+ private:
+  void reclaim_locked() {
+    // A reader that announced epoch e loaded the current version after
+    // every version retired at or before e had been swapped out.
+    auto oldest = UINT64_MAX;
+    for (std::size_t i = 0; i < slot_count_; i++) {
+      auto e = slots_[i].epoch.load();
+      if (e != 0 && e < oldest)
+        oldest = e;
+    }
+
+    std::size_t kept = 0;
+    for (auto v : retired_) {
+      if (v->retired_at <= oldest)
+        delete v;
+      else
+        retired_[kept++] = v;
+    }
+    retired_.resize(kept);
+  }
+
+  std::atomic<version *> current_;
+  std::atomic<std::uint64_t> epoch_{1};
+  std::unique_ptr<slot[]> slots_;
+  std::size_t slot_count_;
+  std::mutex writer_;
+  std::vector<version *> retired_;
+};
+
+NS_GAGO_END
+
+#endif //  GEOJSON_CPP_GAGO_SNAPSHOT_H_
@@ -26,6 +26,11 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <cstdio>
+#include <thread>
+#include <atomic>
+#include <cstdlib>
+#include <new>
 
 #include <boost/geometry.hpp>
 
@@ -33,14 +38,29 @@
 
 using namespace gago::geojson;
 
-enum class geometry_type {
-  POINT = 0,
-  MULTIPOINT,
-  LINESTRING,
-  MULTILINESTRING,
-  POLYGON,
-  MULTIPOLYGON
-};
+// Counts heap allocations, for tests of code that should not allocate.
+static std::atomic<std::size_t> allocations(0);
+
+void *operator new(std::size_t size) {
+  allocations++;
+  if (auto p = std::malloc(size ? size : 1))
+    return p;
+  throw std::bad_alloc();
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+  allocations++;
+  return std::malloc(size ? size : 1);
+}
+
+void operator delete(void *p) noexcept {
+  std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+  std::free(p);
+}
+
 enum class geojson_type {
   GEOMETRY = 0,
   FEATURE,
@@ -58,13 +78,14 @@ enum class value_type {
   MAP
 };
 
-geojson readGeoJSON(const std::string &path) {
+geojson readGeoJSON(const std::string &path,
+                    const convert_options &options = convert_options{}) {
   std::ifstream t(path.c_str());
   std::stringstream buffer;
   buffer << t.rdbuf();
   rapidjson_document d;
   d.Parse<0>(buffer.str().c_str());
-  return convert(d);
+  return convert(d, options);
 }
 
 static void testPoint() {
@@ -72,7 +93,7 @@ static void testPoint() {
   assert(data.which() == int(geojson_type::GEOMETRY));
 
   const auto& geom = boost::get<geometry >(data);
-  assert(geom.which() == (int)geometry_type::POINT);
+  assert(type_of(geom) == geometry_type::POINT);
 
   const auto& p = boost::get<point >(geom);
   assert(p.x() == 30.5);
@@ -84,7 +105,7 @@ static void testMultiPoint() {
   assert(data.which() == int(geojson_type::GEOMETRY));
 
   const auto& geom = boost::get<geometry >(data);
-  assert(geom.which() == (int)geometry_type::MULTIPOINT);
+  assert(type_of(geom) == geometry_type::MULTIPOINT);
 
   const auto& points = boost::get<multi_point >(geom);
   assert(points.size() == 2);
@@ -95,7 +116,7 @@ static void testLineString() {
   assert(data.which() == int(geojson_type::GEOMETRY));
 
   const auto& geom = boost::get<geometry >(data);
-  assert(geom.which() == (int)geometry_type::LINESTRING);
+  assert(type_of(geom) == geometry_type::LINESTRING);
 
   const auto &points = boost::get<linestring>(geom);
   assert(points.size() == 2);
@@ -106,7 +127,7 @@ static void testPolygon() {
   assert(data.which() == int(geojson_type::GEOMETRY));
 
   const auto& geom = boost::get<geometry >(data);
-  assert(geom.which() == (int)geometry_type::POLYGON);
+  assert(type_of(geom) == geometry_type::POLYGON);
 
   const auto &rings = boost::get<polygon>(geom);
   assert(rings.outer().size() == 5);
@@ -118,7 +139,7 @@ static void testMultiPolygon() {
   assert(data.which() == int(geojson_type::GEOMETRY));
 
   const auto& geom = boost::get<geometry >(data);
-  assert(geom.which() == (int)geometry_type::MULTIPOLYGON);
+  assert(type_of(geom) == geometry_type::MULTIPOLYGON);
 
   const auto &polygons = boost::get<multi_polygon >(geom);
   assert(polygons.size() == 1);
@@ -126,12 +147,243 @@ static void testMultiPolygon() {
   assert(boost::geometry::equals(polygons[0].outer()[0], polygons[0].outer()[4]));
 }
 
+static void testTaggedGeometry() {
+  const auto &data = readGeoJSON("test/data/polygon.json");
+  const auto &geom = boost::get<geometry>(data);
+
+  tagged_geometry tagged(geom);
+  assert(tagged.type() == geometry_type::POLYGON);
+  assert(tagged.get<geometry_type::POLYGON>().outer().size() == 5);
+
+  std::size_t points = 0;
+  for_each_point(tagged, [&](const point &) { points++; });
+  assert(points == 5);
+
+  auto size = visit(geom, [](const auto &g) {
+    return boost::geometry::num_points(g);
+  });
+  assert(size == 5);
+
+  tagged = tagged_geometry(point(1, 2));
+  assert(type_of(tagged) == geometry_type::POINT);
+  const auto &back = tagged.to_geometry();
+  assert(type_of(back) == geometry_type::POINT);
+  assert(boost::get<point>(back).y() == 2);
+}
+
+static void testKernels() {
+  namespace kernels = gago::geometry::kernels;
+  using level = kernels::simd_level;
+
+  const auto data = readGeoJSON("test/data/dense-polygon.json");
+  const auto &geom = boost::get<geometry>(data);
+  const auto &p = boost::get<polygon>(geom);
+
+  auto near = [](double a, double b) { return std::abs(a - b) <= 1e-9 * (1 + std::abs(b)); };
+
+  assert(near(kernels::area(geom), boost::geometry::area(p)));
+  auto c = kernels::centroid(geom);
+  point expected;
+  boost::geometry::centroid(p, expected);
+  assert(near(c.x(), expected.x()) && near(c.y(), expected.y()));
+
+  auto b = kernels::envelope(geom);
+  assert(b.min_x == 0 && b.min_y == 0 && b.max_x == 4.001 && b.max_y == 4.001);
+
+  linestring line(p.outer().begin(), p.outer().end());
+  assert(near(kernels::length(line), boost::geometry::length(line)));
+  assert(kernels::length(geom) == 0);
+  assert(kernels::area(geometry(line)) == 0);
+
+  const double *xy = reinterpret_cast<const double *>(p.outer().data());
+  auto n = p.outer().size();
+  const auto &scalar = kernels::detail::kernels_for(level::SCALAR);
+  for (auto l : {level::SSE2, level::AVX2}) {
+    if (l > kernels::best_simd_level())
+      continue;
+    const auto &k = kernels::detail::kernels_for(l);
+    for (std::size_t m = 0; m <= n; m++) {
+      assert(near(k.cross_sum(xy, m), scalar.cross_sum(xy, m)));
+      assert(near(k.length(xy, m), scalar.length(xy, m)));
+      double s1[3] = {0, 0, 0}, s2[3] = {0, 0, 0};
+      k.centroid_sums(xy, m, s1);
+      scalar.centroid_sums(xy, m, s2);
+      assert(near(s1[0], s2[0]) && near(s1[1], s2[1]) && near(s1[2], s2[2]));
+      gago::geometry::bounds<double> e1, e2;
+      k.envelope(xy, m, e1);
+      scalar.envelope(xy, m, e2);
+      assert(e1.min_x == e2.min_x && e1.max_y == e2.max_y);
+    }
+  }
+
+  linestring meridian{{0, 0}, {0, 90}};
+  assert(near(kernels::haversine_length(meridian, 1), M_PI / 2));
+
+  const auto collection = boost::get<feature_collection>(readGeoJSON("test/data/feature-bbox.json"));
+  const auto &areas = kernels::areas(collection, 2);
+  assert(areas.size() == 2 && areas[0] == 0);
+  assert(near(std::abs(areas[1]), 1 + 12 - 0.5));
+}
+
+static void testProjection() {
+  auto near = [](double a, double b, double tolerance) { return std::abs(a - b) <= tolerance; };
+
+  point p(9, 45);
+  gago::geometry::wgs84_to_utm(32)(&p, 1);
+  assert(near(p.x(), 500000, 1e-6));
+  assert(near(p.y(), 4982950.4, 0.1));
+
+  point q(12, 60);
+  gago::geometry::wgs84_to_utm(33)(&q, 1);
+  assert(near(q.x(), 332705.18, 0.01));
+  assert(near(q.y(), 6655205.48, 0.01));
+
+  linestring line{{-73.9857, 40.7484}, {151.2153, -33.8568}, {0, 0}};
+  auto copy = line;
+  gago::geometry::wgs84_to_web_mercator()(copy.data(), copy.size());
+  assert(near(copy[2].x(), 0, 1e-9) && near(copy[2].y(), 0, 1e-9));
+  assert(near(copy[0].x(), -8236050.45, 0.01));
+  gago::geometry::web_mercator_to_wgs84()(copy.data(), copy.size());
+  for (std::size_t i = 0; i < line.size(); i++)
+    assert(near(copy[i].x(), line[i].x(), 1e-9) && near(copy[i].y(), line[i].y(), 1e-9));
+
+  geometry sydney = point(151.2153, -33.8568);
+  auto zone = gago::geometry::utm_zone(151.2153);
+  assert(zone == 56);
+  gago::geometry::transform(sydney, gago::geometry::wgs84_to_utm(zone, false));
+  assert(near(boost::get<point>(sydney).y(), 6252288.75, 0.01));
+  gago::geometry::transform(sydney, gago::geometry::utm_to_wgs84(zone, false));
+  assert(near(boost::get<point>(sydney).x(), 151.2153, 1e-8));
+  assert(near(boost::get<point>(sydney).y(), -33.8568, 1e-8));
+
+  convert_options options;
+  options.bbox = bbox_policy::COMPUTE;
+  options.transform = gago::geometry::wgs84_to_web_mercator();
+  const auto features = boost::get<feature_collection>(
+      readGeoJSON("test/data/tile-features.json", options));
+  const auto &square = boost::get<polygon>(features[0].geometry);
+  assert(near(square.outer()[0].x(), -1113194.9, 0.1));
+  assert(near(features[0].bbox->max_corner().y(), 1118889.97, 0.1));
+
+  // An input bbox is in the source CRS, so it is recomputed.
+  options.bbox = bbox_policy::PREFER_INPUT;
+  const auto boxed = boost::get<feature_collection>(
+      readGeoJSON("test/data/feature-bbox.json", options));
+  assert(near(boxed[0].bbox->min_corner().x(), 0, 1e-9));
+  assert(near(boxed[0].bbox->max_corner().x(), 1113194.9, 0.1));
+
+  // Reprojecting a collection refreshes MultiLineString part boxes too.
+  rapidjson_document d;
+  d.Parse<0>(R"({"type": "FeatureCollection", "features": [{"type": "Feature", "properties": {},
+    "geometry": {"type": "MultiLineString", "coordinates": [[[0, 0], [1, 1]], [[2, 2], [3, 3]]]}}]})");
+  convert_options parts;
+  parts.bbox = bbox_policy::COMPUTE;
+  parts.part_bboxes = true;
+  auto lines = boost::get<feature_collection>(convert<geojson>(d, parts));
+  assert(lines[0].part_bboxes.size() == 2);
+  gago::geometry::transform(lines, gago::geometry::wgs84_to_web_mercator());
+  assert(near(lines[0].part_bboxes[1].min_corner().x(), 222638.98, 0.01));
+  assert(near(lines[0].part_bboxes[1].max_corner().x(), 333958.47, 0.01));
+  assert(near(lines[0].bbox->max_corner().x(), 333958.47, 0.01));
+}
+
+static void testSimplify() {
+  linestring line{{0, 0}, {1, 0.1}, {2, -0.1}, {3, 5}, {4, 6}, {5, 7}};
+  gago::geometry::simplify(line, 0.5);
+  assert(line.size() == 4);
+  assert(boost::geometry::equals(line.front(), point(0, 0)));
+  assert(boost::geometry::equals(line.back(), point(5, 7)));
+
+  // Zero-area rings still keep four points.
+  linestring flat{{0, 0}, {1, 0}, {2, 0}, {1, 0}, {0, 0}};
+  gago::geometry::simplify(flat, 0.5, simplify_method::DOUGLAS_PEUCKER, true);
+  assert(flat.size() == 4);
+  assert(boost::geometry::equals(flat.front(), flat.back()));
+
+  convert_options options;
+  options.simplify_tolerance = 0.01;
+
+  const auto &data = readGeoJSON("test/data/dense-polygon.json", options);
+  const auto &rings = boost::get<polygon>(boost::get<geometry>(data));
+  assert(rings.outer().size() == 5);
+  assert(boost::geometry::equals(rings.outer().front(), rings.outer().back()));
+  assert(rings.inners().size() == 1);
+  assert(rings.inners()[0].size() == 5);
+
+  options.simplify = simplify_method::VISVALINGAM;
+  options.simplify_tolerance = 0.1;
+  const auto &visvalingam = readGeoJSON("test/data/dense-polygon.json", options);
+  const auto &vrings = boost::get<polygon>(boost::get<geometry>(visvalingam));
+  assert(vrings.outer().size() == 5);
+  assert(vrings.inners()[0].size() == 5);
+
+  options.simplify_tolerance = 100;
+  const auto &collapsed = readGeoJSON("test/data/dense-polygon.json", options);
+  const auto &crings = boost::get<polygon>(boost::get<geometry>(collapsed));
+  assert(crings.outer().size() == 4);
+  assert(boost::geometry::equals(crings.outer().front(), crings.outer().back()));
+}
+
+static void testTileIndex() {
+  auto data = readGeoJSON("test/data/tile-features.json");
+  tile_options options;
+  options.index_max_zoom = 2;
+  options.index_max_points = 0;
+  options.cache_size = 8;
+  tile_index index(std::move(boost::get<feature_collection>(data)), options);
+
+  assert(index.get_tile(0, 0, 0)->size() == 3);
+  assert(index.get_tile(1, 0, 0)->size() == 2);
+  assert(index.get_tile(1, 1, 1)->size() == 2);
+
+  // Below the eager index, clipped from the zoom 2 tile on demand.
+  const auto &west = index.get_tile(5, 15, 15);
+  assert(west->size() == 2);
+  assert(index.get_tile(5, 15, 15) == west);
+  for (const auto &f : *west) {
+    if (boost::get<std::string>(f.properties.at("name")) != "square")
+      continue;
+    const auto &ring = boost::get<gago::geometry::polygon<std::int16_t>>(f.geometry).outer();
+    assert(boost::geometry::equals(ring.front(), ring.back()));
+    for (const auto &p : ring) {
+      assert(p.x() >= -64 && p.x() <= 4096 + 64);
+      assert(p.y() >= -64 && p.y() <= 4096 + 64);
+    }
+  }
+
+  const auto &east = index.get_tile(10, 797, 510);
+  assert(east->size() == 1);
+  assert(boost::get<uint64_t>(*east->front().id) == 3);
+  assert(index.get_tile(10, 0, 0)->empty());
+
+  // Deeper zooms would collide in the tile keys.
+  options.max_zoom = 30;
+  bool threw = false;
+  try {
+    tile_index deep(feature_collection{}, options);
+  } catch (const std::invalid_argument &) {
+    threw = true;
+  }
+  assert(threw);
+
+  // Buffered coordinates would overflow int16.
+  options.max_zoom = 14;
+  options.extent = 32768;
+  threw = false;
+  try {
+    tile_index wide(feature_collection{}, options);
+  } catch (const std::invalid_argument &) {
+    threw = true;
+  }
+  assert(threw);
+}
+
 static void testFeature() {
   const auto &data = readGeoJSON("test/data/feature.json");
   assert(data.which() == int(geojson_type::FEATURE));
 
   const auto& f = boost::get<feature>(data);
-  assert(f.geometry.which() == (int)geometry_type::POINT);
+  assert(type_of(f.geometry) == geometry_type::POINT);
 
   assert(f.properties.at("bool").which() == (int)value_type::BOOL);
   assert(boost::get<bool>(f.properties.at("bool")) == true);
@@ -161,6 +413,799 @@ static void testFeature() {
   assert(boost::get<std::string>(boost::get<prop_map >(vec.at(1)).at("foo")) == "bar");
 }
 
+static void testFeatureBoundingBox() {
+  const auto ignored = boost::get<feature_collection>(readGeoJSON("test/data/feature-bbox.json"));
+  assert(!ignored[0].bbox);
+  assert(!ignored[1].bbox);
+
+  convert_options options;
+  options.bbox = bbox_policy::COMPUTE;
+  options.part_bboxes = true;
+
+  const auto computed = boost::get<feature_collection>(
+      readGeoJSON("test/data/feature-bbox.json", options));
+  assert(boost::geometry::equals(*computed[0].bbox, box(point(0, 0), point(10, 10))));
+  assert(boost::geometry::equals(*computed[1].bbox, box(point(0, 0), point(8, 9))));
+  assert(computed[1].part_bboxes.size() == 2);
+  assert(boost::geometry::equals(computed[1].part_bboxes[1], box(point(5, 5), point(8, 9))));
+
+  options.bbox = bbox_policy::PREFER_INPUT;
+  const auto input = boost::get<feature_collection>(
+      readGeoJSON("test/data/feature-bbox.json", options));
+  assert(boost::geometry::equals(*input[0].bbox, box(point(-1, -2), point(11, 12))));
+  assert(boost::geometry::equals(*input[1].bbox, box(point(0, 0), point(8, 9))));
+}
+
+static void testPolygonJoin() {
+  const auto features = boost::get<feature_collection>(readGeoJSON("test/data/feature-bbox.json"));
+  polygon_join join(features);
+
+  assert(join.locate(point(0.5, 0.5)) == 1);
+  assert(join.locate(point(6.2, 6.8)) == polygon_join::npos);
+
+  std::vector<point> points{{0.5, 0.5}, {6.2, 6.8}, {7.5, 8}, {3, 3}, {5, 7}, {-1, 0.5}};
+  const auto &indices = join.join(points, 3);
+  assert(indices.size() == points.size());
+  assert(indices[0] == 1);
+  assert(indices[1] == polygon_join::npos);
+  assert(indices[2] == 1);
+  assert(indices[3] == polygon_join::npos);
+  assert(indices[4] == 1);
+  assert(indices[5] == polygon_join::npos);
+}
+
+static std::string writeToString(const feature_collection &features, const write_options &options) {
+  auto file = std::tmpfile();
+  write(fileno(file), features, options);
+  std::rewind(file);
+
+  std::string text;
+  char buffer[4096];
+  for (std::size_t n; (n = std::fread(buffer, 1, sizeof(buffer), file)) > 0;)
+    text.append(buffer, n);
+  std::fclose(file);
+  return text;
+}
+
+static feature_collection parseFeatureCollection(const std::string &text, const convert_options &options) {
+  rapidjson_document d;
+  d.Parse<0>(text.c_str());
+  assert(!d.HasParseError());
+  return boost::get<feature_collection>(convert(d, options));
+}
+
+static void testWriter() {
+  convert_options options;
+  options.bbox = bbox_policy::COMPUTE;
+  const auto features = boost::get<feature_collection>(readGeoJSON("test/data/tile-features.json", options));
+  options.bbox = bbox_policy::PREFER_INPUT;
+
+  const auto text = stringify(features);
+  const auto roundtrip = parseFeatureCollection(text, options);
+  assert(stringify(roundtrip) == text);
+  assert(boost::geometry::equals(*roundtrip[0].bbox, *features[0].bbox));
+
+  write_options write;
+  write.threads = 3;
+  write.chunk_size = 1;
+  assert(stringify(parseFeatureCollection(writeToString(features, write), options)) == text);
+
+  write.format = output_format::TEXT_SEQUENCE;
+  const auto sequence = writeToString(features, write);
+  assert(sequence[0] == '\x1e');
+  feature_collection records;
+  for (std::size_t begin = 1, end; begin < sequence.size(); begin = end + 1) {
+    end = sequence.find('\x1e', begin);
+    if (end == std::string::npos)
+      end = sequence.size();
+    auto record = sequence.substr(begin, end - begin);
+    assert(record.back() == '\n');
+    rapidjson_document d;
+    d.Parse<0>(record.c_str());
+    records.push_back(convert<feature>(d, options));
+  }
+  assert(stringify(records) == text);
+
+  write.format = output_format::NEWLINE_DELIMITED;
+  write.chunk_size = 2;
+  const auto lines = writeToString(features, write);
+  assert(std::size_t(std::count(lines.begin(), lines.end(), '\n')) == features.size());
+}
+
+static void testSpatialSort() {
+  assert(z_order_key(1, 0) == 1);
+  assert(z_order_key(0, 1) == 2);
+  assert(z_order_key(3, 3) == 15);
+  assert(hilbert_key(0, 0) == 0);
+
+  feature_collection features;
+  for (int i = 15; i >= 0; i--)
+    features.emplace_back(point(i % 4, i / 4));
+  features.emplace_back(multi_point());
+  std::swap(features[3], features[11]);
+
+  auto shuffled = features;
+  write_options write;
+  write.format = output_format::NEWLINE_DELIMITED;
+  write.spatial_order = true;
+  write.threads = 3;
+  const auto lines = writeToString(shuffled, write);
+
+  spatial_sort(features, space_filling_curve::HILBERT, 3);
+  assert(type_of(features[0].geometry) == geometry_type::MULTIPOINT);
+  assert(boost::geometry::equals(boost::get<point>(features[1].geometry), point(0, 0)));
+  for (std::size_t i = 2; i < features.size(); i++) {
+    const auto &a = boost::get<point>(features[i - 1].geometry);
+    const auto &b = boost::get<point>(features[i].geometry);
+    assert(std::abs(a.x() - b.x()) + std::abs(a.y() - b.y()) == 1);
+  }
+
+  std::string sorted;
+  for (const auto &f : features)
+    sorted += stringify(f) + "\n";
+  assert(lines == sorted);
+
+  // Any split into sorted runs, empty ones included, merges to one order.
+  const auto order = gago::geometry::spatial_order(shuffled, space_filling_curve::HILBERT, 1);
+  for (std::size_t threads = 2; threads <= shuffled.size(); threads++)
+    assert(gago::geometry::spatial_order(shuffled, space_filling_curve::HILBERT, threads) == order);
+
+  spatial_sort(features, space_filling_curve::Z_ORDER);
+  assert(boost::geometry::equals(boost::get<point>(features[2].geometry), point(1, 0)));
+  assert(boost::geometry::equals(boost::get<point>(features[3].geometry), point(0, 1)));
+}
+
+static void testFeatureStore() {
+  auto features = boost::get<feature_collection>(readGeoJSON("test/data/tile-features.json"));
+  feature_store<rtree_index> store(features);
+  assert(store.size() == 3);
+  assert(store.index().size() == 3);
+  assert(boost::get<std::string>(store.find(identifier(uint64_t(2)))->properties.at("name")) == "line");
+  assert(!store.find(identifier(std::string("2"))));
+
+  const auto line_slot = store.slot_of(identifier(uint64_t(2)));
+  auto hits = store.index().query(box(point(99, 0), point(101, 1)));
+  assert(hits.size() == 1);
+  assert(type_of(store.at(hits[0]).geometry) == geometry_type::POINT);
+
+  rapidjson_document d;
+  d.Parse<0>(R"({"type": "FeatureCollection", "features": [
+    {"type": "Feature", "id": 2, "properties": {"name": "moved"},
+     "geometry": {"type": "Point", "coordinates": [50, 50]}},
+    {"type": "Feature", "id": 3, "geometry": null},
+    {"type": "Feature", "id": 4, "properties": {},
+     "geometry": {"type": "Point", "coordinates": [100, 1]}},
+    {"type": "Feature", "id": 5, "geometry": null}
+  ]})");
+  const auto stats = apply_patch(store, d);
+  assert(stats.upserted == 2);
+  assert(stats.erased == 1);
+
+  assert(store.size() == 3);
+  assert(store.slot_of(identifier(uint64_t(2))) == line_slot);
+  assert(boost::get<std::string>(store.find(identifier(uint64_t(2)))->properties.at("name")) == "moved");
+  assert(!store.contains(identifier(uint64_t(3))));
+  assert(store.index().size() == 3);
+
+  hits = store.index().query(box(point(99, 0), point(101, 1)));
+  assert(hits.size() == 1);
+  assert(*store.at(hits[0]).id == identifier(uint64_t(4)));
+  assert(store.index().query(box(point(49, 49), point(51, 51))).size() == 1);
+  assert(store.to_collection().size() == 3);
+
+  d.Parse<0>(R"({"type": "Feature", "geometry": null})");
+  bool threw = false;
+  try {
+    apply_patch(store, d);
+  } catch (const error &) {
+    threw = true;
+  }
+  assert(threw);
+}
+
+static void testSnapshotPublisher() {
+  collection_publisher publisher(feature_collection{});
+  std::atomic<bool> done(false);
+  std::atomic<int> failures(0);
+
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 3; t++) {
+    readers.emplace_back([&]() {
+      auto reader = publisher.register_reader();
+      while (!done) {
+        auto snapshot = reader.read();
+        // Every published version holds features numbered 0..n-1.
+        for (std::size_t i = 0; i < snapshot->size(); i++) {
+          if (boost::get<std::uint64_t>(*(*snapshot)[i].id) != i)
+            failures++;
+        }
+      }
+    });
+  }
+
+  for (std::uint64_t version = 1; version <= 200; version++) {
+    feature_collection features;
+    for (std::uint64_t i = 0; i < version % 17; i++)
+      features.emplace_back(point(i, i), prop_map{}, identifier(i));
+    publisher.publish(std::move(features));
+  }
+  done = true;
+  for (auto &r : readers)
+    r.join();
+
+  assert(failures == 0);
+  assert(publisher.reclaim() == 0);
+
+  auto reader = publisher.register_reader();
+  {
+    auto snapshot = reader.read();
+    assert(snapshot->size() == 200 % 17);
+    publisher.publish(feature_collection{});
+    assert(publisher.reclaim() == 1);
+    assert(snapshot->size() == 200 % 17);
+  }
+  assert(publisher.reclaim() == 0);
+  assert(reader.read()->empty());
+}
+
+static void testSharedFeature() {
+  std::ifstream t("test/data/tile-features.json");
+  std::stringstream buffer;
+  buffer << t.rdbuf();
+  rapidjson_document d;
+  d.Parse<0>(buffer.str().c_str());
+
+  const auto features = convert<shared_feature_collection>(d);
+  assert(features.size() == 3);
+  assert(stringify(features) == stringify(boost::get<feature_collection>(convert(d))));
+
+  auto fanned_out = features;
+  assert(fanned_out[0].shares_with(features[0]));
+  assert(features[0].use_count() == 2);
+
+  auto &square = boost::get<polygon>(fanned_out[0].mutate().geometry);
+  boost::geometry::reverse(square);
+  assert(!fanned_out[0].shares_with(features[0]));
+  assert(fanned_out[1].shares_with(features[1]));
+  assert(boost::get<polygon>(features[0]->geometry).outer()[1].x() == 10);
+
+  shared_geometry g(point(1, 2));
+  auto copy = g;
+  copy.mutate() = point(3, 4);
+  assert(boost::get<point>(*g).x() == 1);
+  assert(boost::get<point>(*copy).x() == 3);
+  // A handle that is not shared is mutated in place.
+  auto before = &copy.get();
+  copy.mutate();
+  assert(&copy.get() == before);
+
+  shared_feature_collection owned(boost::get<feature_collection>(convert(d)));
+  assert(owned.to_collection().size() == 3);
+}
+
+static void testTopology() {
+  const auto features = boost::get<feature_collection>(readGeoJSON("test/data/topology.json"));
+  auto topo = build_topology(features, 10001);
+
+  // a and b share one edge and d fills the hole of c, leaving 25 of the
+  // 30 points held by the polygons.
+  assert(topo.arcs.size() == 6);
+  assert(topo.point_count() == 25);
+  assert(topo.objects.size() == 4);
+  assert(topo.objects[2].type == geometry_type::MULTIPOLYGON);
+  const auto &hole = topo.objects[2].polygons[0][1];
+  const auto &island = topo.objects[3].polygons[0][0];
+  assert(hole.size() == 1 && island.size() == 1);
+  assert(hole[0] == ~island[0] || island[0] == ~hole[0]);
+
+  const auto rebuilt = to_features(topo);
+  assert(rebuilt.size() == features.size());
+  for (std::size_t i = 0; i < features.size(); i++) {
+    assert(*rebuilt[i].id == *features[i].id);
+    assert(type_of(rebuilt[i].geometry) == type_of(features[i].geometry));
+    if (type_of(features[i].geometry) == geometry_type::POLYGON)
+      assert(boost::geometry::equals(boost::get<polygon>(rebuilt[i].geometry),
+                                     boost::get<polygon>(features[i].geometry)));
+    else
+      assert(boost::geometry::equals(boost::get<multi_polygon>(rebuilt[i].geometry),
+                                     boost::get<multi_polygon>(features[i].geometry)));
+  }
+
+  // Two squares sharing a border: each ring is the shared arc plus the
+  // rest of its square, which must not collapse onto the shared arc.
+  feature_collection squares;
+  squares.emplace_back(polygon{{{0, 0}, {0, 1}, {1, 1}, {1, 0}, {0, 0}}});
+  squares.emplace_back(polygon{{{1, 0}, {1, 1}, {2, 1}, {2, 0}, {1, 0}}});
+  auto joined = build_topology(squares, 11);
+  gago::geometry::simplify(joined, 100);
+  const auto simplified = to_features(joined);
+  for (const auto &f : simplified) {
+    const auto &outer = boost::get<polygon>(f.geometry).outer();
+    assert(outer.size() >= 4);
+    assert(boost::geometry::area(outer) != 0);
+  }
+  assert(find_invalid(simplified).empty());
+
+  bool threw = false;
+  try {
+    build_topology(feature_collection{feature{point(0, 0)}});
+  } catch (const std::invalid_argument &) {
+    threw = true;
+  }
+  assert(threw);
+}
+
+static void testValidation() {
+  rapidjson_document d;
+  // Unclosed, clockwise outer ring with a clockwise hole.
+  d.Parse<0>(R"({"type": "Polygon", "coordinates": [
+    [[0, 0], [0, 10], [10, 10], [10, 0]],
+    [[2, 2], [2, 4], [4, 4], [4, 2], [2, 2]]
+  ]})");
+
+  assert(boost::get<polygon>(convert<geometry>(d)).outer().size() == 4);
+
+  convert_options options;
+  options.validation = ring_validation::CHECK;
+  bool threw = false;
+  try {
+    convert<geometry>(d, options);
+  } catch (const error &) {
+    threw = true;
+  }
+  assert(threw);
+
+  options.validation = ring_validation::FIX;
+  options.orientation = ring_orientation::COUNTERCLOCKWISE;
+  auto p = boost::get<polygon>(convert<geometry>(d, options));
+  assert(p.outer().size() == 5);
+  assert(boost::geometry::equals(p.outer().front(), p.outer().back()));
+  // The model is clockwise, so RFC 7946 rings have negative Boost areas.
+  assert(boost::geometry::area(p.outer()) < 0);
+  assert(boost::geometry::area(p.inners()[0]) > 0);
+
+  options.orientation = ring_orientation::CLOCKWISE;
+  p = boost::get<polygon>(convert<geometry>(d, options));
+  assert(boost::geometry::area(p) == 96);
+
+  // Orientation of a ring left open includes its closing edge.
+  d.Parse<0>(R"({"type": "Polygon", "coordinates": [[[0, 20], [1, 10], [2, 20]]]})");
+  options.validation = ring_validation::NONE;
+  options.orientation = ring_orientation::COUNTERCLOCKWISE;
+  const auto open = boost::get<polygon>(convert<geometry>(d, options));
+  assert(open.outer().size() == 3);
+  assert(boost::geometry::equals(open.outer().front(), point(0, 20)));
+  options.orientation = ring_orientation::CLOCKWISE;
+  assert(boost::geometry::equals(boost::get<polygon>(convert<geometry>(d, options)).outer().front(),
+                                 point(2, 20)));
+  options.validation = ring_validation::FIX;
+
+  d.Parse<0>(R"({"type": "Polygon", "coordinates": [[[0, 0], [1, 1], [0, 0]]]})");
+  threw = false;
+  try {
+    convert<geometry>(d, options);
+  } catch (const error &) {
+    threw = true;
+  }
+  assert(threw);
+
+  feature_collection features;
+  features.emplace_back(p);
+  // A bowtie: closed, four positions, but self-intersecting.
+  d.Parse<0>(R"({"type": "Polygon", "coordinates": [[[0, 0], [10, 10], [10, 0], [0, 10], [0, 0]]]})");
+  features.emplace_back(convert<geometry>(d, options));
+  features.emplace_back(point(1, 1));
+
+  const auto invalid = find_invalid(features, 2);
+  assert(invalid.size() == 1);
+  assert(invalid[0].index == 1);
+  assert(!invalid[0].reason.empty());
+}
+
+static void testPointGrid() {
+  point_grid grid(box(point(0, 0), point(100, 100)), 10);
+  for (std::size_t i = 0; i < 100; i++)
+    grid.insert(i, point(i, i));
+  assert(grid.size() == 100);
+
+  auto ids = grid.query(point(50, 50), 3);
+  std::sort(ids.begin(), ids.end());
+  assert((ids == std::vector<std::size_t>{48, 49, 50, 51, 52}));
+
+  grid.insert(50, point(0, 99));
+  assert(grid.remove(49));
+  assert(!grid.remove(49));
+  ids = grid.query(box(point(45, 45), point(55, 55)));
+  std::sort(ids.begin(), ids.end());
+  assert((ids == std::vector<std::size_t>{45, 46, 47, 48, 51, 52, 53, 54, 55}));
+  assert(grid.query(point(0, 100), 1) == std::vector<std::size_t>{50});
+
+  const auto packed = grid.pack(3);
+  assert(packed.size() == 99);
+  ids = packed.query(box(point(45, 45), point(55, 55)));
+  std::sort(ids.begin(), ids.end());
+  assert((ids == std::vector<std::size_t>{45, 46, 47, 48, 51, 52, 53, 54, 55}));
+  // Points outside the extent land in the edge cells and are still found.
+  grid.insert(1000, point(-5, -5));
+  assert(grid.query(point(-5, -5), 0.5) == std::vector<std::size_t>{1000});
+
+  const auto features = boost::get<feature_collection>(readGeoJSON("test/data/tile-features.json"));
+  const auto by_feature = packed_point_grid::from_features(features, 1);
+  assert(by_feature.size() == 1);
+  assert(by_feature.query(point(100, 0), 1) == std::vector<std::size_t>{2});
+
+  feature_store<point_grid> store(features, point_grid(box(point(-180, -90), point(180, 90)), 1));
+  assert(store.index().size() == 3);
+  assert(store.index().query(point(100.5, 0.5), 0.1).size() == 1);
+}
+
+static void testSummary() {
+  auto file = std::fopen("test/data/feature-bbox.json", "rb");
+  assert(file);
+  const auto summary = summarize(file);
+  std::fclose(file);
+
+  assert(summary.feature_collections == 1);
+  assert(summary.features == 2);
+  assert(summary.count(geometry_type::LINESTRING) == 1);
+  assert(summary.count(geometry_type::MULTIPOLYGON) == 1);
+  assert(summary.count(geometry_type::POINT) == 0);
+  // The bbox member is not a position.
+  assert(summary.positions == 3 + 5 + 5 + 4);
+  assert(summary.extent.min_x == 0 && summary.extent.max_x == 10);
+  assert(summary.extent.min_y == 0 && summary.extent.max_y == 10);
+  assert(summary.properties.empty());
+
+  const auto mixed = summarize(R"({"type": "FeatureCollection", "features": [
+    {"type": "Feature", "geometry": null, "properties": {"a": 1, "b": "x", "c": {"type": "Point"}}},
+    {"type": "Feature", "properties": {"a": -1.5, "b": null, "d": [1, {"e": 2}]},
+     "geometry": {"coordinates": [3, 4], "type": "Point"}},
+    {"type": "Feature", "properties": {"a": -2},
+     "geometry": {"type": "GeometryCollection", "geometries": []}}
+  ]})");
+  assert(mixed.features == 3);
+  assert(mixed.null_geometries == 1);
+  assert(mixed.count(geometry_type::POINT) == 1);
+  assert(mixed.unknown_types == 1);
+  assert(mixed.positions == 1);
+  assert(mixed.extent.min_x == 3 && mixed.extent.max_y == 4);
+  assert(mixed.properties.size() == 4);
+  const auto &a = mixed.properties.at("a");
+  assert(a.count() == 3);
+  assert(a.count(property_type::UINT) == 1);
+  assert(a.count(property_type::DOUBLE) == 1);
+  assert(a.count(property_type::INT) == 1);
+  assert(mixed.properties.at("b").count(property_type::NIL) == 1);
+  assert(mixed.properties.at("c").count(property_type::MAP) == 1);
+  assert(mixed.properties.at("d").count(property_type::VECTOR) == 1);
+
+  // Property keys only allocate the first time they are seen, however
+  // many features repeat them.
+  const std::string long_keys = R"({"type": "Feature", "geometry": null,
+    "properties": {"a_rather_long_property_name": 1, "another_long_property_key": "x"}})";
+  auto summarize_copies = [&long_keys](std::size_t n) {
+    std::string json = R"({"type": "FeatureCollection", "features": [)";
+    for (std::size_t i = 0; i < n; i++)
+      json += (i ? "," : "") + long_keys;
+    json += "]}";
+    const auto before = allocations.load();
+    const auto counted = summarize(json.data(), json.size());
+    assert(counted.properties.at("a_rather_long_property_name").count() == n);
+    return allocations.load() - before;
+  };
+  assert(summarize_copies(1) == summarize_copies(50));
+
+  bool threw = false;
+  try {
+    summarize("{\"type\": ");
+  } catch (const error &) {
+    threw = true;
+  }
+  assert(threw);
+}
+
+static void testParserContext() {
+  parser_context context(1024);
+  feature f{point()};
+
+  context.parse(R"({"type": "Feature", "id": 7, "properties": {"name": "first", "speed": 1},
+    "geometry": {"type": "LineString", "coordinates": [[0, 0], [1, 1], [2, 2]]}})", f);
+  assert(boost::get<uint64_t>(*f.id) == 7);
+  const auto *points = boost::get<linestring>(f.geometry).data();
+  const auto *name = &f.properties.at("name");
+
+  context.parse(R"({"type": "Feature", "properties": {"name": "second"},
+    "geometry": {"type": "LineString", "coordinates": [[5, 5], [6, 6]]}})", f);
+  const auto &line = boost::get<linestring>(f.geometry);
+  assert(line.size() == 2);
+  assert(line.data() == points);
+  assert(line[1].x() == 6);
+  assert(!f.id);
+  assert(f.properties.size() == 1);
+  assert(&f.properties.at("name") == name);
+  assert(boost::get<std::string>(f.properties.at("name")) == "second");
+
+  convert_options options;
+  options.bbox = bbox_policy::COMPUTE;
+  context.parse(R"({"type": "Feature", "properties": null,
+    "geometry": {"type": "Polygon", "coordinates": [[[0, 0], [0, 3], [3, 3], [0, 0]]]}})", f, options);
+  assert(type_of(f.geometry) == geometry_type::POLYGON);
+  assert(f.properties.empty());
+  assert(f.bbox->max_corner().y() == 3);
+
+  // A document larger than the buffers makes them grow for the next parse.
+  std::string big = R"({"type": "Feature", "properties": {}, "geometry": {"type": "MultiPoint", "coordinates": [)";
+  for (int i = 0; i < 1000; i++)
+    big += (i ? ",[" : "[") + std::to_string(i) + ",1]";
+  big += "]}}";
+  context.parse(big, f);
+  assert(boost::get<multi_point>(f.geometry).size() == 1000);
+  context.parse(big, f);
+  assert(context.buffer_size() > 1024);
+
+  bool threw = false;
+  try {
+    context.parse("{\"type\":", f);
+  } catch (const error &) {
+    threw = true;
+  }
+  assert(threw);
+  assert(context.parse("[1, 2]").Size() == 2);
+
+  // Once warmed up, parsing features of the same shape does not allocate,
+  // keys longer than short strings included.
+  const std::string record = R"({"type": "Feature", "id": 1,
+    "properties": {"a_rather_long_property_name": "value", "another_long_property_key": 2.5},
+    "geometry": {"type": "LineString", "coordinates": [[0, 0], [1, 1], [2, 2]]}})";
+  context.parse(record, f);
+  context.parse(record, f);
+  const auto before = allocations.load();
+  for (int i = 0; i < 100; i++)
+    context.parse(record, f);
+  assert(allocations.load() == before);
+  assert(boost::get<std::string>(f.properties.at("a_rather_long_property_name")) == "value");
+}
+
+// A builder for an engine's own types, counting what it is given.
+struct vertex_builder {
+  struct vertex {
+    float x, y;
+  };
+
+  std::vector<vertex> vertices;
+  std::vector<std::size_t> path_sizes;
+  std::vector<std::string> names;
+  std::size_t features = 0, polygons = 0, null_geometries = 0;
+
+  void begin_collection(std::size_t) {}
+  void end_collection() {}
+  void begin_feature() { features++; }
+  void id(const rapidjson_value &) {}
+  void bbox(const rapidjson_value &) {}
+  void property(const char *key, std::size_t length, const rapidjson_value &v) {
+    if (std::string(key, length) == "name")
+      names.emplace_back(v.GetString());
+  }
+  void null_geometry() { null_geometries++; }
+  void end_feature() {}
+  void begin_geometry(geometry_type, std::size_t) {}
+  void end_geometry() {}
+  void begin_polygon(std::size_t) { polygons++; }
+  void end_polygon() {}
+  void begin_path(std::size_t positions) { path_sizes.push_back(positions); }
+  void end_path() {}
+  void position(double x, double y) { vertices.push_back(vertex{float(x), float(y)}); }
+};
+
+static void testBuilder() {
+  std::ifstream t("test/data/tile-features.json");
+  std::stringstream buffer;
+  buffer << t.rdbuf();
+  rapidjson_document d;
+  d.Parse<0>(buffer.str().c_str());
+
+  vertex_builder custom;
+  build(d, custom);
+  assert(custom.features == 3);
+  assert(custom.polygons == 1);
+  assert(custom.vertices.size() == 5 + 3 + 1);
+  assert((custom.path_sizes == std::vector<std::size_t>{5, 3}));
+  assert((custom.names == std::vector<std::string>{"square", "line", "point"}));
+  assert(custom.vertices.back().x == 100.5f);
+
+  geometry_builder<> builder;
+  build(d, builder);
+  assert(stringify(builder.features()) == stringify(boost::get<feature_collection>(convert(d))));
+
+  rapidjson_document g;
+  g.Parse<0>(R"({"type": "MultiLineString", "coordinates": [[[0, 0], [1, 1]], [[2, 2], [3, 3], [4, 4]]]})");
+  geometry_builder<std::int32_t> ints;
+  build(g, ints);
+  const auto &lines = boost::get<gago::geometry::multi_linestring<std::int32_t>>(ints.geometry());
+  assert(lines.size() == 2);
+  assert(lines[1].size() == 3);
+  assert(lines[1][2].x() == 4);
+  // The converters are the same walk, so they take MultiLineStrings too.
+  assert(boost::get<multi_linestring>(convert<geometry>(g))[1].size() == 3);
+
+  // geometry_builder applies convert_options like the converters do.
+  convert_options options;
+  options.bbox = bbox_policy::COMPUTE;
+  options.part_bboxes = true;
+  g.Parse<0>(R"({"type": "Feature", "properties": {"a": 1},
+    "geometry": {"type": "MultiLineString", "coordinates": [[[0, 0], [1, 1]], [[2, 2], [3, 5]]]}})");
+  geometry_builder<> configured(options);
+  build(g, configured);
+  const auto &built = configured.features().front();
+  assert(built.bbox->max_corner().y() == 5);
+  assert(built.part_bboxes.size() == 2);
+  assert(built.part_bboxes[1].min_corner().x() == 2);
+  assert(stringify(built) == stringify(convert<feature>(g, options)));
+
+  g.Parse<0>(R"({"type": "Feature", "properties": null, "geometry": null})");
+  vertex_builder empty;
+  build(g, empty);
+  assert(empty.null_geometries == 1);
+}
+
+static void testIngest() {
+  const std::vector<std::string> paths{
+      "test/data/feature-collection.json",
+      "test/data/missing.json",
+      "test/data/feature.json",
+      "test/data/polygon.json",
+      "test/data/tile-features.json"};
+
+  ingest_options options;
+  options.readers = 2;
+  options.parsers = 2;
+  options.queue_size = 1;
+  const auto results = ingest_all(paths, options);
+
+  assert(results.size() == paths.size());
+  assert(results[0].ok() && results[0].features.size() == 2);
+  assert(!results[1].ok() && results[1].path == paths[1]);
+  assert(results[2].ok() && results[2].features.size() == 1);
+  assert(results[3].ok() && type_of(results[3].features[0].geometry) == geometry_type::POLYGON);
+  assert(results[4].features.size() == 3);
+
+  std::size_t seen = 0;
+  auto failed = ingest(paths, [&seen](ingest_result &&) { seen++; }, options);
+  assert(failed == 1);
+  assert(seen == paths.size());
+
+  bool threw = false;
+  try {
+    ingest(paths, [](ingest_result &&) { throw std::logic_error("stop"); }, options);
+  } catch (const std::logic_error &) {
+    threw = true;
+  }
+  assert(threw);
+
+  // Anything else thrown in a stage stops the pipeline and is rethrown.
+  options.convert.transform = [](point *, std::size_t) { throw 42; };
+  threw = false;
+  try {
+    ingest_all(paths, options);
+  } catch (int) {
+    threw = true;
+  }
+  assert(threw);
+}
+
+static double rasterTotal(const raster &r) {
+  double total = 0;
+  for (auto v : r.values)
+    total += v;
+  return total;
+}
+
+static void testRasterize() {
+  rapidjson_document d;
+  d.Parse<0>(R"({"type": "FeatureCollection", "features": [
+    {"type": "Feature", "properties": {"v": 2},
+     "geometry": {"type": "Polygon", "coordinates": [[[2, 2], [5, 2], [5, 5], [2, 5], [2, 2]]]}},
+    {"type": "Feature", "properties": {"v": 3.5},
+     "geometry": {"type": "Polygon", "coordinates": [[[4, 4], [6, 4], [6, 6], [4, 6], [4, 4]]]}},
+    {"type": "Feature", "properties": {"v": "text"},
+     "geometry": {"type": "LineString", "coordinates": [[0.5, 9.5], [9.5, 9.5], [9.5, 9.2]]}}
+  ]})");
+  const auto features = boost::get<feature_collection>(convert(d));
+
+  raster_options options;
+  options.width = 10;
+  options.height = 10;
+  options.extent = box(point(0, 0), point(10, 10));
+  options.threads = 3;
+
+  auto counts = rasterize(features, options);
+  // Row 0 is the top of the extent.
+  assert(counts.at(2, 7) == 1);
+  assert(counts.at(4, 5) == 2);
+  assert(counts.at(5, 5) == 1);
+  assert(counts.at(1, 7) == 0);
+  assert(counts.at(9, 0) == 1);
+  assert(rasterTotal(counts) == 9 + 4 + 10);
+
+  options.mode = raster_mode::SUM;
+  options.property = "v";
+  auto sums = rasterize(features, options);
+  assert(sums.at(4, 5) == 5.5);
+  assert(sums.at(9, 0) == 0);
+
+  options.mode = raster_mode::MAX;
+  auto maxima = rasterize(features, options);
+  assert(maxima.at(4, 5) == 3.5);
+  assert(maxima.at(2, 7) == 2);
+  assert(maxima.at(1, 7) == 0);
+
+  // Covered cells report the largest value even when all are negative.
+  feature_collection negative;
+  negative.emplace_back(polygon{{{2, 2}, {5, 2}, {5, 5}, {2, 5}, {2, 2}}});
+  negative.back().properties["v"] = std::int64_t(-4);
+  negative.emplace_back(polygon{{{4, 4}, {6, 4}, {6, 6}, {4, 6}, {4, 4}}});
+  negative.back().properties["v"] = -1.5;
+  auto lows = rasterize(negative, options);
+  assert(lows.at(2, 7) == -4);
+  assert(lows.at(4, 5) == -1.5);
+  assert(lows.at(1, 7) == 0);
+
+  feature_collection shifted;
+  shifted.emplace_back(polygon{{{2.5, 2}, {2.5, 5}, {5, 5}, {5, 2}, {2.5, 2}}});
+  shifted.emplace_back(polygon{{{0, 0}, {0, 10}, {10, 10}, {10, 0}, {0, 0}},
+                               {{{1, 1}, {9, 1}, {9, 9}, {1, 9}, {1, 1}}}});
+  options.mode = raster_mode::COUNT;
+  options.antialias = true;
+  auto coverage = rasterize(shifted, options);
+  assert(coverage.at(2, 6) == 0.5);
+  assert(coverage.at(0, 6) == 1);
+  assert(coverage.at(3, 6) == 1);
+  assert(std::abs(rasterTotal(coverage) - (7.5 + 36)) < 1e-9);
+
+  options.antialias = false;
+  // The centers of column 2 lie on the left edge, which is inside.
+  assert(rasterTotal(rasterize(shifted, options)) == 9 + 36);
+}
+
+static void testMemoryUsage() {
+  auto features = boost::get<feature_collection>(readGeoJSON("test/data/tile-features.json"));
+  linestring line{{0, 0}, {1, 1}, {2, 0}};
+  line.reserve(1000);
+  prop_map properties;
+  properties.reserve(1000);
+  properties["name"] = std::string(100, 'x');
+  properties["nested"] = std::vector<value>{std::string(50, 'y'), uint64_t(1)};
+  features.emplace_back(std::move(line), std::move(properties), identifier{std::string(40, 'z')});
+  features.emplace_back(polygon{{{0, 0}, {0, 10}, {10, 10}, {10, 0}, {0, 0}},
+                                {{{1, 1}, {9, 1}, {9, 9}, {1, 9}, {1, 1}}}});
+  features.reserve(features.size() * 4);
+  const auto copy = features;
+
+  auto before = memory_usage(features, 3);
+  assert(before.coordinates > 0);
+  assert(before.rings > 0);
+  assert(before.property_keys > 0);
+  assert(before.values >= 150);
+  assert(before.overhead > 0);
+  assert(before.slack >= 997 * sizeof(point));
+  assert(before.total() == memory_usage(features).total());
+
+  compact(features, 3);
+  auto after = memory_usage(features);
+  assert(after.slack == 0);
+  assert(after.total() <= before.total() - before.slack);
+  assert(after.coordinates == before.coordinates);
+  assert(after.property_keys == before.property_keys);
+  // Rehashing may reorder properties, so compare features one by one.
+  assert(features.size() == copy.size());
+  for (std::size_t i = 0; i < features.size(); i++) {
+    assert(stringify(features[i].geometry) == stringify(copy[i].geometry));
+    assert(features[i].properties.size() == copy[i].properties.size());
+    for (const auto &member : copy[i].properties)
+      assert(stringify(features[i].properties.at(member.first)) == stringify(member.second));
+  }
+}
+
 static void testFeatureCollection() {
   const auto &data = readGeoJSON("test/data/feature-collection.json");
   assert(data.which() == int(geojson_type::FEATURECOLLECTION));
@@ -176,8 +1221,29 @@ void testAll() {
   testLineString();
   testPolygon();
   testMultiPolygon();
+  testTaggedGeometry();
+  testKernels();
+  testProjection();
+  testSimplify();
+  testTileIndex();
   testFeature();
   testFeatureCollection();
+  testFeatureBoundingBox();
+  testPolygonJoin();
+  testWriter();
+  testSpatialSort();
+  testFeatureStore();
+  testSnapshotPublisher();
+  testSharedFeature();
+  testTopology();
+  testValidation();
+  testPointGrid();
+  testSummary();
+  testParserContext();
+  testBuilder();
+  testIngest();
+  testRasterize();
+  testMemoryUsage();
 }
 
 int main() {